@@ -0,0 +1,237 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <QTextStream>
+
+#include "barcode.h"
+#include "barcodecheck.h"
+
+// Format information for the medium error correction level and masks 0-7,
+// from the table in ISO/IEC 18004
+const char *const QrFormatStrings[] = {
+    "101010000010010", "101000100100101", "101111001111100", "101101101001011",
+    "100010111111001", "100000011001110", "100111110010111", "100101010100000"
+};
+
+// Version information for version 7 (000111110010010100)
+const int QrVersion7Bits = 0x07C94;
+
+// "HELLO WORLD" in byte mode at version 1-M: 16 data codewords followed by
+// 10 error correction codewords
+const quint8 HelloWorldCodewords[] = {
+    64, 180, 132, 84, 196, 196, 242, 5, 116, 245, 36, 196, 64, 236, 17, 236,
+    12, 75, 207, 154, 137, 79, 101, 9, 151, 204
+};
+
+/**
+ * @brief Code 128 payload with its bar and space widths
+ */
+struct Code128Case
+{
+    const char *payload;
+    const char *widths;
+};
+
+// Start, data, check and stop symbols: code set B only (check value 55),
+// code set C only (check value 44) and a switch from B to C (check value 57)
+const Code128Case Code128Cases[] = {
+    { "PJJ123C", "2112143131211121331121331232212232112211321313213113212331112" },
+    { "123456", "2112321122321311233311211321312331112" },
+    { "AB12345678", "2112141113231311231131411122321311233311212411123121132331112" }
+};
+
+// Whether mask pattern 0-7 inverts the module at (x, y)
+static bool qrMasked(int mask, int x, int y)
+{
+    switch (mask) {
+    case 0: return (x + y) % 2 == 0;
+    case 1: return y % 2 == 0;
+    case 2: return x % 3 == 0;
+    case 3: return (x + y) % 3 == 0;
+    case 4: return (x / 3 + y / 2) % 2 == 0;
+    case 5: return x * y % 2 + x * y % 3 == 0;
+    case 6: return (x * y % 2 + x * y % 3) % 2 == 0;
+    default: return ((x + y) % 2 + x * y % 3) % 2 == 0;
+    }
+}
+
+int BarcodeCheck::run()
+{
+    QTextStream out(stderr);
+    int failures = 0;
+
+    auto report = [&out, &failures](const QString &name, const QString &error) {
+        if (!error.isEmpty()) {
+            ++failures;
+        }
+        out << name << ": " << (error.isEmpty() ? QString("ok") : error) << endl;
+    };
+
+    for (const Code128Case &code128Case : Code128Cases) {
+        report(QString("code128 \"%1\"").arg(code128Case.payload),
+               checkCode128(code128Case.payload, code128Case.widths));
+    }
+    report("qr \"HELLO WORLD\"",
+           checkQrCode("HELLO WORLD", HelloWorldCodewords, sizeof(HelloWorldCodewords)));
+    report("qr version 7", checkQrVersion(QString(110, 'A'), 7, QrVersion7Bits));
+
+    out << failures << " failed" << endl;
+    return failures;
+}
+
+QString BarcodeCheck::checkCode128(const QString &payload, const char *widths) const
+{
+    Barcode barcode = Barcode::encode(Barcode::Code128, payload);
+    if (barcode.isNull() || barcode.size().height() != 1) {
+        return "not encoded";
+    }
+
+    // Measure each run of modules, starting with a bar
+    QString actual;
+    int run = 0;
+    for (int x = 0; x < barcode.size().width(); ++x) {
+        if (x && barcode.module(x, 0) != barcode.module(x - 1, 0)) {
+            actual.append(QString::number(run));
+            run = 0;
+        }
+        ++run;
+    }
+    actual.append(QString::number(run));
+
+    if (!barcode.module(0, 0) || actual != widths) {
+        return QString("expected widths %1, got %2").arg(widths).arg(actual);
+    }
+    return QString();
+}
+
+QString BarcodeCheck::checkQrCode(const QString &payload, const quint8 *codewords, int count) const
+{
+    Barcode barcode = Barcode::encode(Barcode::QrCode, payload);
+    if (barcode.isNull() || barcode.size() != QSize(21, 21)) {
+        return "not encoded as version 1";
+    }
+    QString error;
+    int mask = formatMask(barcode, &error);
+    if (mask < 0) {
+        return error;
+    }
+
+    // Read the codewords in placement order, skipping the finders (with
+    // their separators and format information) and the timing patterns
+    int size = barcode.size().width();
+    QByteArray actual(count, 0);
+    int bit = 0;
+    for (int right = size - 1; right >= 1; right -= 2) {
+        if (right == 6) {
+            right = 5;
+        }
+        bool upward = ((right + 1) & 2) == 0;
+        for (int i = 0; i < size; ++i) {
+            int y = upward ? size - 1 - i : i;
+            for (int j = 0; j < 2; ++j) {
+                int x = right - j;
+                bool function = (x <= 8 && (y <= 8 || y >= size - 8)) ||
+                        (x >= size - 8 && y <= 8) || x == 6 || y == 6;
+                if (function || bit >= count * 8) {
+                    continue;
+                }
+                if (barcode.module(x, y) != qrMasked(mask, x, y)) {
+                    actual[bit >> 3] = actual.at(bit >> 3) | (0x80 >> (bit & 7));
+                }
+                ++bit;
+            }
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (static_cast<quint8>(actual.at(i)) != codewords[i]) {
+            return QString("codeword %1 is %2 instead of %3")
+                    .arg(i)
+                    .arg(static_cast<quint8>(actual.at(i)))
+                    .arg(codewords[i]);
+        }
+    }
+    return QString();
+}
+
+QString BarcodeCheck::checkQrVersion(const QString &payload, int version, int versionBits) const
+{
+    Barcode barcode = Barcode::encode(Barcode::QrCode, payload);
+    int size = version * 4 + 17;
+    if (barcode.isNull() || barcode.size() != QSize(size, size)) {
+        return QString("not encoded as version %1").arg(version);
+    }
+    QString error;
+    if (formatMask(barcode, &error) < 0) {
+        return error;
+    }
+
+    // Both copies are 6x3 blocks next to the bottom left and top right
+    // finders, least significant bit first
+    int bottomLeft = 0;
+    int topRight = 0;
+    for (int i = 0; i < 18; ++i) {
+        bottomLeft |= barcode.module(i / 3, size - 11 + i % 3) << i;
+        topRight |= barcode.module(size - 11 + i % 3, i / 3) << i;
+    }
+    if (bottomLeft != versionBits || topRight != versionBits) {
+        return QString("version information is %1 and %2 instead of %3")
+                .arg(bottomLeft, 18, 2, QChar('0'))
+                .arg(topRight, 18, 2, QChar('0'))
+                .arg(versionBits, 18, 2, QChar('0'));
+    }
+    return QString();
+}
+
+int BarcodeCheck::formatMask(const Barcode &barcode, QString *error) const
+{
+    // Read both copies of the format information, most significant bit first
+    int size = barcode.size().width();
+    QString first;
+    QString second;
+    for (int i = 14; i >= 0; --i) {
+        int x = 8;
+        int y = 8;
+        if (i <= 5) {
+            y = i;
+        } else if (i <= 7) {
+            y = i + 1;
+        } else if (i == 8) {
+            x = 7;
+        } else {
+            x = 14 - i;
+        }
+        first.append(barcode.module(x, y) ? '1' : '0');
+        second.append((i < 8 ? barcode.module(size - 1 - i, 8) : barcode.module(8, size - 15 + i)) ? '1' : '0');
+    }
+
+    for (int mask = 0; mask < 8; ++mask) {
+        if (first == QrFormatStrings[mask] && second == QrFormatStrings[mask]) {
+            return mask;
+        }
+    }
+    *error = QString("format information %1 / %2 is not for level M").arg(first).arg(second);
+    return -1;
+}
@@ -0,0 +1,56 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#ifndef BARCODECHECK_H
+#define BARCODECHECK_H
+
+#include <QString>
+
+class Barcode;
+
+/**
+ * @brief Compare encoded barcodes with known answers
+ *
+ * Code 128 symbols are compared bar for bar with symbols worked out from the
+ * specification. QR codes are read back the way a scanner would, checking
+ * the format and version information against the published tables and the
+ * codewords against independently computed data and error correction.
+ */
+class BarcodeCheck
+{
+public:
+
+    int run();
+
+private:
+
+    QString checkCode128(const QString &payload, const char *widths) const;
+    QString checkQrCode(const QString &payload, const quint8 *codewords, int count) const;
+    QString checkQrVersion(const QString &payload, int version, int versionBits) const;
+
+    int formatMask(const Barcode &barcode, QString *error) const;
+};
+
+#endif // BARCODECHECK_H
@@ -0,0 +1,327 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPageSize>
+#include <QPainter>
+#include <QPair>
+#include <QTextStream>
+
+#include "barcode.h"
+#include "barcodecheck.h"
+#include "fitcache.h"
+#include "fitengine.h"
+#include "goldencheck.h"
+#include "sheet.h"
+#include "spoolcheck.h"
+
+// Grid sizes (rows and columns) to benchmark
+const int GridSizes[] = { 1, 5, 10, 20 };
+
+// Text used to fill each cell
+const char *const ShortText = "A1";
+const char *const LongText = "Warehouse 4 - Aisle 12 - Bin 7";
+const char *const Texts[] = { ShortText, LongText };
+
+/**
+ * @brief Target that sheets are drawn on
+ */
+struct Target
+{
+    const char *name;
+    int dpi;
+    bool points;
+};
+
+// The preview uses 36 DPI pixels for its logical coordinates while
+// printing uses points at the printer's resolution
+const Target Targets[] = {
+    { "preview", 36, false },
+    { "printer", 1200, true }
+};
+
+/**
+ * @brief Run a benchmark until it has used at least the minimum time
+ */
+template<typename Func>
+static QJsonObject measure(qint64 minTime, Func func)
+{
+    QElapsedTimer timer;
+    qint64 iterations = 0;
+    timer.start();
+    do {
+        func();
+        ++iterations;
+    } while (timer.nsecsElapsed() < minTime * 1000000);
+
+    QJsonObject result;
+    result.insert("iterations", static_cast<double>(iterations));
+    result.insert("nsPerIteration", static_cast<double>(timer.nsecsElapsed()) / iterations);
+    return result;
+}
+
+static Sheet createSheet(int gridSize, const QString &text, int orientation)
+{
+    Sheet sheet;
+    sheet.orientation = orientation;
+    sheet.hSpacing = 20;
+    sheet.border = 4;
+    sheet.margin = 16;
+    sheet.headerText = "FRAGILE";
+    sheet.setRows(gridSize);
+    sheet.setCols(gridSize);
+    for (int i = 0; i < gridSize; ++i) {
+        for (int j = 0; j < gridSize; ++j) {
+            sheet.cell(i, j).setText(QString("%1 %2").arg(text).arg(i * gridSize + j));
+        }
+    }
+    return sheet;
+}
+
+static QJsonArray benchmarkDraw(const Target &target, qint64 minTime)
+{
+    QJsonArray results;
+
+    QPageSize pageSize(QPageSize::Letter);
+    int dotsPerMeter = qRound(target.dpi / 0.0254);
+
+    for (int orientation = Sheet::Portrait; orientation <= Sheet::Landscape; ++orientation) {
+        QSize size = target.points ? pageSize.sizePoints() : pageSize.sizePixels(target.dpi);
+        QSize imageSize = pageSize.sizePixels(target.dpi);
+        if (orientation == Sheet::Landscape) {
+            size.transpose();
+            imageSize.transpose();
+        }
+
+        // Create the image once for each orientation, since it can be
+        // very large at printer resolution
+        QImage image(imageSize, QImage::Format_Grayscale8);
+        image.setDotsPerMeterX(dotsPerMeter);
+        image.setDotsPerMeterY(dotsPerMeter);
+
+        for (int gridSize : GridSizes) {
+            for (const char *text : Texts) {
+                Sheet sheet = createSheet(gridSize, text, orientation);
+
+                // Cold draws fit everything from scratch
+                QJsonObject cold = measure(minTime, [&]() {
+                    FitCache::instance()->clear();
+                    image.fill(Qt::white);
+                    sheet.draw(&image, size);
+                });
+
+                // Warm draws find every size in the cache
+                QJsonObject warm = measure(minTime, [&]() {
+                    image.fill(Qt::white);
+                    sheet.draw(&image, size);
+                });
+
+                foreach (const QString &name, QStringList() << "draw_cold" << "draw_warm") {
+                    QJsonObject result = name == "draw_cold" ? cold : warm;
+                    result.insert("name", name);
+                    result.insert("target", target.name);
+                    result.insert("orientation", orientation == Sheet::Portrait ? "portrait" : "landscape");
+                    result.insert("grid", QString("%1x%1").arg(gridSize));
+                    result.insert("text", text == ShortText ? "short" : "long");
+                    results.append(result);
+                }
+            }
+        }
+    }
+
+    return results;
+}
+
+static QJsonArray benchmarkFit(const Target &target, qint64 minTime)
+{
+    QJsonArray results;
+
+    // Measurement only needs the resolution, not a full page
+    QPageSize pageSize(QPageSize::Letter);
+    QSize size = target.points ? pageSize.sizePoints() : pageSize.sizePixels(target.dpi);
+    QSize deviceSize = pageSize.sizePixels(target.dpi);
+    int dotsPerMeter = qRound(target.dpi / 0.0254);
+    QImage image(1, 1, QImage::Format_RGB32);
+    image.setDotsPerMeterX(dotsPerMeter);
+    image.setDotsPerMeterY(dotsPerMeter);
+
+    QPainter painter(&image);
+    painter.setWindow(0, 0, size.width(), size.height());
+    painter.setViewport(0, 0, deviceSize.width(), deviceSize.height());
+
+    for (int gridSize : GridSizes) {
+        for (const char *text : Texts) {
+            Sheet sheet = createSheet(gridSize, text, Sheet::Portrait);
+            QRectF rect = sheet.cellRect(size, 0, 0);
+
+            // Fit without the cache so that every fit is measured
+            FitEngine engine(painter);
+            int fits = 0;
+            QJsonObject result = measure(minTime, [&]() {
+                engine.fit(sheet.font, rect, text);
+                ++fits;
+            });
+            result.insert("name", "fit");
+            result.insert("target", target.name);
+            result.insert("grid", QString("%1x%1").arg(gridSize));
+            result.insert("text", text == ShortText ? "short" : "long");
+            result.insert("measurementsPerFit", static_cast<double>(engine.totalMeasurements()) / fits);
+            results.append(result);
+        }
+    }
+
+    return results;
+}
+
+static QJsonArray benchmarkBarcodes(qint64 minTime)
+{
+    QJsonArray results;
+
+    const QPair<Barcode::Symbology, const char*> symbologies[] = {
+        qMakePair(Barcode::Code128, "code128"),
+        qMakePair(Barcode::QrCode, "qr")
+    };
+    for (const auto &symbology : symbologies) {
+
+        // Every payload is distinct, as in a large manifest
+        qint64 serial = 0;
+        QJsonObject uncached = measure(minTime, [&]() {
+            Barcode::encode(symbology.first, QString("SKU-%1").arg(++serial, 8, 10, QChar('0')));
+        });
+        uncached.insert("name", "encode");
+        uncached.insert("symbology", symbology.second);
+        uncached.insert("codesPerSecond", 1e9 / uncached.value("nsPerIteration").toDouble());
+        results.append(uncached);
+
+        // Redrawing the same payloads finds them in the cache
+        QJsonObject cached = measure(minTime, [&]() {
+            Barcode::get(symbology.first, QString("SKU-%1").arg(++serial % 100, 8, 10, QChar('0')));
+        });
+        cached.insert("name", "encode_cached");
+        cached.insert("symbology", symbology.second);
+        cached.insert("codesPerSecond", 1e9 / cached.value("nsPerIteration").toDouble());
+        results.append(cached);
+    }
+
+    return results;
+}
+
+int main(int argc, char **argv)
+{
+    // Nothing is displayed, so there is no need for a display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark sheet rendering.");
+    parser.addHelpOption();
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Write results to a file.", "file");
+    QCommandLineOption minTimeOption("min-time", "Minimum time for each benchmark (in ms).", "ms", "200");
+    QCommandLineOption goldenOption("golden", "Compare against golden images instead.", "dir");
+    QCommandLineOption updateOption("update", "Write the golden images instead of comparing.");
+    QCommandLineOption seedOption("seed", "Write the golden images if there are none yet.");
+    QCommandLineOption toleranceOption("tolerance", "Channel difference allowed per pixel.", "value", "32");
+    QCommandLineOption barcodesOption("check-barcodes", "Compare encoded barcodes with known answers instead.");
+    QCommandLineOption spoolOption("check-spool", "Check that older spool files are read instead.");
+    QCommandLineOption budgetScaleOption("budget-scale", "Multiply time budgets by a factor.", "factor", "1");
+    parser.addOption(outputOption);
+    parser.addOption(minTimeOption);
+    parser.addOption(goldenOption);
+    parser.addOption(updateOption);
+    parser.addOption(seedOption);
+    parser.addOption(toleranceOption);
+    parser.addOption(budgetScaleOption);
+    parser.addOption(barcodesOption);
+    parser.addOption(spoolOption);
+    parser.process(app);
+
+    // Check barcodes if requested
+    if (parser.isSet(barcodesOption)) {
+        return BarcodeCheck().run() ? 1 : 0;
+    }
+
+    // Check older spools if requested
+    if (parser.isSet(spoolOption)) {
+        return SpoolCheck().run() ? 1 : 0;
+    }
+
+    // Check golden images if requested
+    if (parser.isSet(goldenOption)) {
+        GoldenCheck check(parser.value(goldenOption));
+        check.setUpdate(parser.isSet(updateOption));
+        check.setSeed(parser.isSet(seedOption));
+        check.setTolerance(parser.value(toleranceOption).toInt());
+        check.setBudgetScale(parser.value(budgetScaleOption).toDouble());
+
+        // Report a missing corpus the way CTest reports a skipped test
+        int failures = check.run();
+        return failures < 0 ? 77 : failures ? 1 : 0;
+    }
+
+    qint64 minTime = qMax(parser.value(minTimeOption).toLongLong(), 1LL);
+
+    QJsonArray results;
+    for (const Target &target : Targets) {
+        foreach (const QJsonValue &value, benchmarkFit(target, minTime)) {
+            results.append(value);
+        }
+        foreach (const QJsonValue &value, benchmarkDraw(target, minTime)) {
+            results.append(value);
+        }
+    }
+    foreach (const QJsonValue &value, benchmarkBarcodes(minTime)) {
+        results.append(value);
+    }
+
+    QJsonObject object;
+    object.insert("qtVersion", qVersion());
+    object.insert("results", results);
+    QByteArray json = QJsonDocument(object).toJson();
+
+    // Write the results to the file or stdout
+    QFile file;
+    bool opened;
+    if (parser.isSet(outputOption)) {
+        file.setFileName(parser.value(outputOption));
+        opened = file.open(QIODevice::WriteOnly);
+    } else {
+        opened = file.open(stdout, QIODevice::WriteOnly);
+    }
+    if (!opened || file.write(json) != json.size()) {
+        QTextStream(stderr) << "unable to write results: " << file.errorString() << endl;
+        return 1;
+    }
+
+    return 0;
+}
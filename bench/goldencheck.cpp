@@ -0,0 +1,322 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include <QElapsedTimer>
+#include <QPageSize>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+#include "displaylist.h"
+#include "fitcache.h"
+#include "goldencheck.h"
+#include "sheet.h"
+
+// Resolution that golden images are rendered at
+const int GoldenDpi = 100;
+
+// Number of times each case is drawn to find its median time
+const int TimedRuns = 5;
+
+// Fraction of pixels that may differ before a case fails
+const double MaxDifference = 0.001;
+
+// Resolutions that display lists are checked at, as written to PNG files
+const int ListDpis[] = { 100, 200, 300 };
+
+// Most that the ink covered by a display list may differ from Sheet::draw,
+// which fits text at the device's resolution rather than the reference one
+const double MaxCoverageDifference = 0.1;
+
+/**
+ * @brief Reference sheet with its time budget
+ */
+struct GoldenCase
+{
+    const char *name;
+    const char *header;
+    const char *footer;
+    const char *family;
+    int orientation;
+    int hSpacing;
+    int vSpacing;
+    int border;
+    int margin;
+    int rows;
+    int cols;
+    int budget;
+};
+
+// Budgets (in ms) are for a cold fit cache and leave room for slower machines
+const GoldenCase GoldenCases[] = {
+    { "single", "", "", "Sans", Sheet::Portrait, 0, 0, 0, 0, 1, 1, 20 },
+    { "single-landscape", "", "", "Sans", Sheet::Landscape, 0, 0, 4, 16, 1, 1, 20 },
+    { "header", "FRAGILE", "", "Sans", Sheet::Portrait, 0, 0, 4, 16, 2, 2, 30 },
+    { "footer", "", "Warehouse 4", "Serif", Sheet::Landscape, 20, 0, 4, 16, 2, 3, 30 },
+    { "header-footer", "FRAGILE", "Warehouse 4", "Sans", Sheet::Landscape, 20, 10, 8, 32, 3, 3, 40 },
+    { "spacing", "", "", "Serif", Sheet::Portrait, 40, 40, 0, 0, 4, 4, 60 },
+    { "monospace", "THIS SIDE UP", "", "Monospace", Sheet::Portrait, 10, 10, 2, 8, 5, 5, 80 },
+    { "dense", "Bin labels", "Aisle 12", "Sans", Sheet::Portrait, 4, 4, 1, 8, 20, 20, 400 }
+};
+
+GoldenCheck::GoldenCheck(const QString &directory)
+    : mDirectory(directory),
+      mUpdate(false),
+      mSeed(false),
+      mWriting(false),
+      mTolerance(32),
+      mBudgetScale(1)
+{
+}
+
+void GoldenCheck::setUpdate(bool update)
+{
+    mUpdate = update;
+}
+
+void GoldenCheck::setSeed(bool seed)
+{
+    mSeed = seed;
+}
+
+void GoldenCheck::setTolerance(int tolerance)
+{
+    mTolerance = tolerance;
+}
+
+void GoldenCheck::setBudgetScale(double budgetScale)
+{
+    mBudgetScale = budgetScale;
+}
+
+int GoldenCheck::run()
+{
+    QTextStream out(stderr);
+    int failures = 0;
+
+    // Golden images have to be generated on the machine that checks them
+    bool empty = mDirectory.entryList(QStringList() << "*.png", QDir::Files).isEmpty();
+    mWriting = mUpdate || (mSeed && empty);
+    if (mWriting && !mDirectory.mkpath(".")) {
+        out << "unable to create " << mDirectory.path() << endl;
+        return 1;
+    }
+    if (!mWriting && empty) {
+        out << "no golden images in " << mDirectory.path() << " (generate them with --update)" << endl;
+        return -1;
+    }
+    if (mWriting && !mUpdate) {
+        out << "writing golden images to " << mDirectory.path() << endl;
+    }
+
+    for (const GoldenCase &goldenCase : GoldenCases) {
+        Sheet sheet;
+        sheet.headerText = goldenCase.header;
+        sheet.footerText = goldenCase.footer;
+        sheet.font = QFont(goldenCase.family);
+        sheet.orientation = goldenCase.orientation;
+        sheet.hSpacing = goldenCase.hSpacing;
+        sheet.vSpacing = goldenCase.vSpacing;
+        sheet.border = goldenCase.border;
+        sheet.margin = goldenCase.margin;
+        sheet.setRows(goldenCase.rows);
+        sheet.setCols(goldenCase.cols);
+        for (int i = 0; i < goldenCase.rows; ++i) {
+            for (int j = 0; j < goldenCase.cols; ++j) {
+                sheet.cell(i, j).setText(QString("SKU-%1").arg(i * goldenCase.cols + j + 1001));
+            }
+        }
+
+        // Draw the sheet several times and take the median time
+        QVector<qint64> times;
+        QImage image;
+        for (int i = 0; i < TimedRuns; ++i) {
+            qint64 nsecs;
+            image = render(sheet, &nsecs);
+            times.append(nsecs);
+        }
+        std::sort(times.begin(), times.end());
+        double elapsed = times.at(TimedRuns / 2) / 1000000.0;
+        double budget = goldenCase.budget * mBudgetScale;
+
+        QString status = compare(image, QString("%1.png").arg(goldenCase.name));
+        if (!mUpdate) {
+            if (status == "ok" && elapsed > budget) {
+                status = QString("over budget of %1 ms").arg(budget);
+            }
+            if (status == "ok") {
+                QString error = checkList(sheet);
+                if (!error.isEmpty()) {
+                    status = error;
+                }
+            }
+        }
+
+        // Replaying the display list must also match at each resolution
+        for (int dpi : ListDpis) {
+            if (status != "ok") {
+                break;
+            }
+            QSize size;
+            QImage listImage = page(sheet, dpi, &size);
+            DisplayList::compile(sheet, size).draw(&listImage);
+            status = compare(listImage, QString("%1-list-%2.png").arg(goldenCase.name).arg(dpi));
+            if (status != "ok") {
+                status = QString("display list at %1 DPI: %2").arg(dpi).arg(status);
+            }
+        }
+
+        if (status != "ok") {
+            ++failures;
+        }
+        out << goldenCase.name << ": " << status
+            << " (" << QString::number(elapsed, 'f', 2) << " ms)" << endl;
+    }
+
+    out << failures << " failed" << endl;
+    return failures;
+}
+
+QImage GoldenCheck::page(const Sheet &sheet, int dpi, QSize *size) const
+{
+    QPageSize pageSize(QPageSize::Letter);
+    *size = pageSize.sizePoints();
+    QSize imageSize = pageSize.sizePixels(dpi);
+    if (sheet.orientation == Sheet::Landscape) {
+        size->transpose();
+        imageSize.transpose();
+    }
+
+    QImage image(imageSize, QImage::Format_ARGB32_Premultiplied);
+    int dotsPerMeter = qRound(dpi / 0.0254);
+    image.setDotsPerMeterX(dotsPerMeter);
+    image.setDotsPerMeterY(dotsPerMeter);
+    image.fill(Qt::white);
+
+    return image;
+}
+
+QImage GoldenCheck::render(const Sheet &sheet, qint64 *nsecs) const
+{
+    QSize size;
+    QImage image = page(sheet, GoldenDpi, &size);
+
+    // Time drawing from scratch, as for the first copy of a new sheet
+    FitCache::instance()->clear();
+    QElapsedTimer timer;
+    timer.start();
+    sheet.draw(&image, size);
+    *nsecs = timer.nsecsElapsed();
+
+    return image;
+}
+
+QString GoldenCheck::compare(const QImage &image, const QString &name) const
+{
+    QString filename = mDirectory.filePath(name);
+    if (mWriting) {
+        return image.save(filename) ? "ok" : "unable to write image";
+    }
+
+    QImage golden(filename);
+    if (golden.isNull()) {
+        return "missing golden image";
+    }
+    double diff = difference(image, golden);
+    if (diff > MaxDifference) {
+        return QString("%1% of pixels differ").arg(diff * 100, 0, 'f', 2);
+    }
+
+    return "ok";
+}
+
+QString GoldenCheck::checkList(const Sheet &sheet) const
+{
+    // Compare with Sheet::draw on an identical device
+    for (int dpi : ListDpis) {
+        QSize size;
+        QImage expected = page(sheet, dpi, &size);
+        sheet.draw(&expected, size);
+        QImage actual = page(sheet, dpi, &size);
+        DisplayList::compile(sheet, size).draw(&actual);
+
+        double expectedCoverage = coverage(expected);
+        double actualCoverage = coverage(actual);
+        if (qAbs(actualCoverage - expectedCoverage) > expectedCoverage * MaxCoverageDifference) {
+            return QString("display list at %1 DPI covers %2% of the page instead of %3%")
+                    .arg(dpi)
+                    .arg(actualCoverage * 100, 0, 'f', 2)
+                    .arg(expectedCoverage * 100, 0, 'f', 2);
+        }
+    }
+
+    return QString();
+}
+
+double GoldenCheck::coverage(const QImage &image) const
+{
+    QImage gray = image.convertToFormat(QImage::Format_Grayscale8);
+
+    // Count pixels that are closer to black than to white
+    qint64 covered = 0;
+    for (int y = 0; y < gray.height(); ++y) {
+        const uchar *line = gray.constScanLine(y);
+        for (int x = 0; x < gray.width(); ++x) {
+            if (line[x] < 128) {
+                ++covered;
+            }
+        }
+    }
+
+    return static_cast<double>(covered) / (gray.width() * gray.height());
+}
+
+double GoldenCheck::difference(const QImage &image, const QImage &golden) const
+{
+    if (image.size() != golden.size()) {
+        return 1;
+    }
+
+    QImage first = image.convertToFormat(QImage::Format_ARGB32);
+    QImage second = golden.convertToFormat(QImage::Format_ARGB32);
+
+    // Count pixels where any channel differs by more than the tolerance
+    qint64 differing = 0;
+    for (int y = 0; y < first.height(); ++y) {
+        const QRgb *a = reinterpret_cast<const QRgb*>(first.constScanLine(y));
+        const QRgb *b = reinterpret_cast<const QRgb*>(second.constScanLine(y));
+        for (int x = 0; x < first.width(); ++x) {
+            if (qAbs(qRed(a[x]) - qRed(b[x])) > mTolerance ||
+                    qAbs(qGreen(a[x]) - qGreen(b[x])) > mTolerance ||
+                    qAbs(qBlue(a[x]) - qBlue(b[x])) > mTolerance ||
+                    qAbs(qAlpha(a[x]) - qAlpha(b[x])) > mTolerance) {
+                ++differing;
+            }
+        }
+    }
+
+    return static_cast<double>(differing) / (first.width() * first.height());
+}
@@ -0,0 +1,79 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GOLDENCHECK_H
+#define GOLDENCHECK_H
+
+#include <QDir>
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+class Sheet;
+
+/**
+ * @brief Compare rendered sheets against golden images
+ *
+ * Each sheet in the corpus is drawn to an offscreen image and compared with
+ * the image of the same name in the golden directory. A case fails if too
+ * many pixels differ or if drawing it exceeds its time budget. Each sheet is
+ * also compiled into a display list and replayed at several resolutions,
+ * which must match golden images of their own and cover about as much of
+ * the page as Sheet::draw. Golden images depend on the fonts installed, so
+ * they should be generated (with update mode) on the machine that checks
+ * them; run() returns -1 if there are none to compare against. In seed mode
+ * an empty directory is filled instead, while budgets and display lists are
+ * still checked, so that later runs are compared with the first one.
+ */
+class GoldenCheck
+{
+public:
+
+    explicit GoldenCheck(const QString &directory);
+
+    void setUpdate(bool update);
+    void setSeed(bool seed);
+    void setTolerance(int tolerance);
+    void setBudgetScale(double budgetScale);
+
+    int run();
+
+private:
+
+    QImage page(const Sheet &sheet, int dpi, QSize *size) const;
+    QImage render(const Sheet &sheet, qint64 *nsecs) const;
+    QString compare(const QImage &image, const QString &name) const;
+    QString checkList(const Sheet &sheet) const;
+    double coverage(const QImage &image) const;
+    double difference(const QImage &image, const QImage &golden) const;
+
+    QDir mDirectory;
+    bool mUpdate;
+    bool mSeed;
+    bool mWriting;
+    int mTolerance;
+    double mBudgetScale;
+};
+
+#endif // GOLDENCHECK_H
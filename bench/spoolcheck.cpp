@@ -0,0 +1,183 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QtEndian>
+
+#include "printspool.h"
+#include "sheet.h"
+#include "spoolcheck.h"
+
+// Header of a spool file as written by every version so far
+const quint32 SpoolMagic = 0x42535000;
+const quint32 CurrentVersion = 3;
+
+// Destination stored with each sheet
+const char *const Destination = "pdf:labels.pdf";
+
+static Sheet createSheet(const QString &text, Cell::Type type)
+{
+    Sheet sheet;
+    sheet.headerText = "FRAGILE";
+    sheet.copies = 2;
+    sheet.setRows(1);
+    sheet.setCols(2);
+    sheet.cell(0, 0).setText(text);
+    sheet.cell(0, 1).setText("B2");
+    sheet.cell(0, 1).setType(type);
+    return sheet;
+}
+
+static bool sameSheet(const Sheet &a, const Sheet &b)
+{
+    if (a.headerText != b.headerText || a.copies != b.copies ||
+            a.rows() != b.rows() || a.cols() != b.cols()) {
+        return false;
+    }
+    for (int i = 0; i < a.cells().count(); ++i) {
+        if (a.cells().at(i).text() != b.cells().at(i).text() ||
+                a.cells().at(i).type() != b.cells().at(i).type()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int SpoolCheck::run()
+{
+    QTextStream out(stderr);
+    int failures = 0;
+
+    for (int version = 1; version < static_cast<int>(CurrentVersion); ++version) {
+        QString error = checkUpgrade(version);
+        if (!error.isEmpty()) {
+            ++failures;
+        }
+        out << "spool version " << version << ": "
+            << (error.isEmpty() ? QString("ok") : error) << endl;
+    }
+
+    out << failures << " failed" << endl;
+    return failures;
+}
+
+QString SpoolCheck::checkUpgrade(int version) const
+{
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        return "unable to create a temporary directory";
+    }
+    QString filename = directory.path() + "/spool";
+
+    // Cell types were not stored before version 2
+    Sheet oldSheet = createSheet("A1", version < 2 ? Cell::Text : Cell::Code128);
+    if (!writeOldSpool(filename, version, oldSheet)) {
+        return "unable to write the spool";
+    }
+
+    // Reading the spool upgrades it, so it must still read the same after
+    // it has been closed and opened again
+    for (int pass = 0; pass < 2; ++pass) {
+        QString error = checkSheet(filename, 0, oldSheet);
+        if (!error.isEmpty()) {
+            return QString("pass %1: %2").arg(pass + 1).arg(error);
+        }
+    }
+
+    // Sheets added to the upgraded spool are in the current format
+    Sheet newSheet = createSheet("C3", Cell::QrCode);
+    {
+        PrintSpool spool;
+        if (!spool.open(filename)) {
+            return spool.errorString();
+        }
+        if (spool.append(Destination, newSheet) < 0) {
+            return spool.errorString();
+        }
+    }
+    QString error = checkSheet(filename, 0, oldSheet);
+    if (error.isEmpty()) {
+        error = checkSheet(filename, 1, newSheet);
+    }
+    return error.isEmpty() ? QString() : QString("after append: %1").arg(error);
+}
+
+QString SpoolCheck::checkSheet(const QString &filename, int index, const Sheet &expected) const
+{
+    PrintSpool spool;
+    if (!spool.open(filename)) {
+        return spool.errorString();
+    }
+    QList<qint64> pending = spool.pending();
+    if (index >= pending.count()) {
+        return QString("%1 sheets pending").arg(pending.count());
+    }
+
+    QString destination;
+    SheetSnapshot sheet;
+    if (!spool.read(pending.at(index), &destination, &sheet)) {
+        return spool.errorString();
+    }
+    if (destination != Destination || !sameSheet(*sheet, expected)) {
+        return QString("sheet %1 differs").arg(index + 1);
+    }
+    return QString();
+}
+
+bool SpoolCheck::writeOldSpool(const QString &filename, int version, const Sheet &sheet) const
+{
+    // Records had a data size, a state and three bytes of padding
+    QByteArray data(8, 0);
+    {
+        QDataStream stream(&data, QIODevice::WriteOnly | QIODevice::Append);
+        stream.setVersion(QDataStream::Qt_5_7);
+        stream << QString(Destination)
+               << sheet.headerText << sheet.footerText << sheet.font
+               << static_cast<qint32>(sheet.orientation)
+               << static_cast<qint32>(sheet.hSpacing) << static_cast<qint32>(sheet.vSpacing)
+               << static_cast<qint32>(sheet.border) << static_cast<qint32>(sheet.margin)
+               << static_cast<qint32>(sheet.copies)
+               << static_cast<qint32>(sheet.rows()) << static_cast<qint32>(sheet.cols());
+        foreach (const Cell &cell, sheet.cells()) {
+            stream << cell.text();
+            if (version >= 2) {
+                stream << static_cast<qint32>(cell.type());
+            }
+        }
+    }
+    qToBigEndian<quint32>(data.size() - 8, data.data());
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream << SpoolMagic << static_cast<quint32>(version);
+    return stream.status() == QDataStream::Ok && file.write(data) == data.size();
+}
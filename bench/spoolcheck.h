@@ -0,0 +1,54 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#ifndef SPOOLCHECK_H
+#define SPOOLCHECK_H
+
+#include <QString>
+
+class Sheet;
+
+/**
+ * @brief Check that spools written by older versions are still read
+ *
+ * A spool is written the way each older version wrote it, then opened,
+ * closed and opened again, and every sheet in it must read back intact
+ * both times. A sheet added in the current format must read back too.
+ */
+class SpoolCheck
+{
+public:
+
+    int run();
+
+private:
+
+    QString checkUpgrade(int version) const;
+    QString checkSheet(const QString &filename, int index, const Sheet &expected) const;
+
+    bool writeOldSpool(const QString &filename, int version, const Sheet &sheet) const;
+};
+
+#endif // SPOOLCHECK_H
@@ -0,0 +1,716 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstdlib>
+
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+
+#include "barcode.h"
+#include "cell.h"
+
+// Largest total number of modules in cached symbols
+const int MaxCachedModules = 16 * 1024 * 1024;
+
+// Width of the blank margin around each symbol (in modules)
+const int Code128QuietZone = 10;
+const int QrCodeQuietZone = 4;
+
+// Bar and space widths for each Code 128 symbol value; the last is the stop
+const char *const Code128Patterns[] = {
+    "212222", "222122", "222221", "121223", "121322", "131222", "122213", "122312",
+    "132212", "221213", "221312", "231212", "112232", "122132", "122231", "113222",
+    "123122", "123221", "223211", "221132", "221231", "213212", "223112", "312131",
+    "311222", "321122", "321221", "312212", "322112", "322211", "212123", "212321",
+    "232121", "111323", "131123", "131321", "112313", "132113", "132311", "211313",
+    "231113", "231311", "112133", "112331", "132131", "113123", "113321", "133121",
+    "313121", "211331", "231131", "213113", "213311", "213131", "311123", "311321",
+    "331121", "312113", "312311", "332111", "314111", "221411", "431111", "111224",
+    "111422", "121124", "121421", "141122", "141221", "112214", "112412", "122114",
+    "122411", "142112", "142211", "241211", "221114", "413111", "241112", "134111",
+    "111242", "121142", "121241", "114212", "124112", "124211", "411212", "421112",
+    "421211", "212141", "214121", "412121", "111143", "111341", "131141", "114113",
+    "114311", "411113", "411311", "113141", "114131", "311141", "411131", "211412",
+    "211214", "211232", "2331112"
+};
+
+// Code 128 symbol values with special meanings
+const int Code128CodeC = 99;
+const int Code128CodeB = 100;
+const int Code128StartB = 104;
+const int Code128StartC = 105;
+const int Code128Stop = 106;
+
+// Error correction codewords per block and number of blocks for each QR code
+// version (starting at 1) at the medium error correction level
+const int QrEccCodewordsPerBlock[] = {
+    10, 16, 26, 18, 24, 16, 18, 22, 22, 26, 30, 22, 22, 24, 24, 28, 28, 26, 26, 26,
+    26, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28
+};
+const int QrEccBlocks[] = {
+    1, 1, 1, 2, 2, 4, 4, 4, 5, 5, 5, 8, 9, 9, 10, 10, 11, 13, 14, 16,
+    17, 17, 18, 20, 21, 23, 25, 26, 28, 29, 31, 33, 35, 37, 38, 40, 43, 45, 47, 49
+};
+const int QrMaxVersion = 40;
+
+// Format information bits for the medium error correction level
+const int QrEccFormatBits = 0;
+
+/**
+ * @brief QR code modules under construction
+ */
+struct QrMatrix
+{
+    explicit QrMatrix(int version)
+        : size(version * 4 + 17),
+          modules(size * size, 0),
+          function(size * size, 0)
+    {
+    }
+
+    bool get(int x, int y) const
+    {
+        return modules.at(y * size + x);
+    }
+
+    void set(int x, int y, bool dark)
+    {
+        modules[y * size + x] = dark;
+    }
+
+    void setFunction(int x, int y, bool dark)
+    {
+        set(x, y, dark);
+        function[y * size + x] = 1;
+    }
+
+    bool isFunction(int x, int y) const
+    {
+        return function.at(y * size + x);
+    }
+
+    int size;
+    QVector<quint8> modules;
+    QVector<quint8> function;
+};
+
+QSharedPointer<const Barcode> Barcode::get(Symbology symbology, const QString &payload)
+{
+    typedef QPair<int, QString> Key;
+
+    static QMutex mutex;
+    static QCache<Key, QSharedPointer<const Barcode>> cache(MaxCachedModules);
+
+    Key key(symbology, payload);
+    {
+        QMutexLocker locker(&mutex);
+        QSharedPointer<const Barcode> *cached = cache.object(key);
+        if (cached) {
+            return *cached;
+        }
+    }
+
+    // Encode outside of the lock so that threads don't wait on each other
+    QSharedPointer<const Barcode> barcode(new Barcode(encode(symbology, payload)));
+
+    QMutexLocker locker(&mutex);
+    cache.insert(
+        key,
+        new QSharedPointer<const Barcode>(barcode),
+        qMax(barcode->mModules.count(), 1)
+    );
+    return barcode;
+}
+
+QSharedPointer<const Barcode> Barcode::get(const Cell &cell)
+{
+    QSharedPointer<const Barcode> barcode;
+    switch (cell.type()) {
+    case Cell::Code128:
+        barcode = get(Code128, cell.text());
+        break;
+    case Cell::QrCode:
+        barcode = get(QrCode, cell.text());
+        break;
+    default:
+        return barcode;
+    }
+    return barcode->isNull() ? QSharedPointer<const Barcode>() : barcode;
+}
+
+Barcode Barcode::encode(Symbology symbology, const QString &payload)
+{
+    switch (symbology) {
+    case Code128:
+        // Only printable ASCII can be encoded
+        foreach (QChar c, payload) {
+            if (c.unicode() < 32 || c.unicode() > 126) {
+                return Barcode();
+            }
+        }
+        return encodeCode128(payload.toLatin1());
+    default:
+        return encodeQrCode(payload.toUtf8());
+    }
+}
+
+bool Barcode::isNull() const
+{
+    return mModules.isEmpty();
+}
+
+Barcode::Symbology Barcode::symbology() const
+{
+    return mSymbology;
+}
+
+QSize Barcode::size() const
+{
+    return mSize;
+}
+
+bool Barcode::module(int x, int y) const
+{
+    return mModules.at(y * mSize.width() + x);
+}
+
+void Barcode::draw(QPainter &painter, const QRectF &rect) const
+{
+    if (isNull()) {
+        return;
+    }
+
+    // Scale modules to fill the rect, leaving room for the quiet zone; QR
+    // codes must keep square modules but bars can be any height
+    QRectF target;
+    if (mSymbology == QrCode) {
+        qreal side = qMin(rect.width(), rect.height());
+        qreal moduleSize = side / (mSize.width() + QrCodeQuietZone * 2);
+        side = moduleSize * mSize.width();
+        target = QRectF(0, 0, side, side);
+        target.moveCenter(rect.center());
+    } else {
+        qreal moduleSize = rect.width() / (mSize.width() + Code128QuietZone * 2);
+        target = QRectF(0, 0, moduleSize * mSize.width(), rect.height());
+        target.moveCenter(rect.center());
+    }
+
+    painter.save();
+    painter.translate(target.topLeft());
+    painter.scale(target.width() / mSize.width(), target.height() / mSize.height());
+    painter.fillPath(mPath, Qt::black);
+    painter.restore();
+}
+
+Barcode::Barcode()
+    : mSymbology(Code128)
+{
+}
+
+Barcode Barcode::encodeCode128(const QByteArray &data)
+{
+    Barcode barcode;
+    barcode.mSymbology = Code128;
+    if (data.isEmpty()) {
+        return barcode;
+    }
+
+    // Count the digits from each position onwards
+    QVector<int> digits(data.size() + 1, 0);
+    for (int i = data.size() - 1; i >= 0; --i) {
+        digits[i] = data.at(i) >= '0' && data.at(i) <= '9' ? digits.at(i + 1) + 1 : 0;
+    }
+
+    // Use code set C (two digits per symbol) for runs of digits that are long
+    // enough to save space and code set B for everything else
+    QVector<int> values;
+    bool setC = digits.at(0) >= 4 || (digits.at(0) == data.size() && digits.at(0) % 2 == 0);
+    values.append(setC ? Code128StartC : Code128StartB);
+    int i = 0;
+    while (i < data.size()) {
+        if (setC) {
+            if (digits.at(i) >= 2) {
+                values.append((data.at(i) - '0') * 10 + data.at(i + 1) - '0');
+                i += 2;
+                continue;
+            }
+            values.append(Code128CodeB);
+            setC = false;
+        }
+
+        // Switch to code set C for an even run of digits, taking one digit in
+        // code set B first if the run is odd
+        int run = digits.at(i);
+        bool atEnd = i + run == data.size();
+        if (run >= 6 || (run >= 4 && atEnd)) {
+            if (run % 2) {
+                values.append(data.at(i) - 32);
+                ++i;
+            }
+            values.append(Code128CodeC);
+            setC = true;
+            continue;
+        }
+
+        values.append(data.at(i) - 32);
+        ++i;
+    }
+
+    // Add the checksum and stop symbol
+    int checksum = values.first();
+    for (int j = 1; j < values.count(); ++j) {
+        checksum += j * values.at(j);
+    }
+    values.append(checksum % 103);
+    values.append(Code128Stop);
+
+    // Expand the symbols into alternating bars and spaces
+    QVector<quint8> modules;
+    foreach (int value, values) {
+        const char *pattern = Code128Patterns[value];
+        for (int j = 0; pattern[j]; ++j) {
+            for (int k = 0; k < pattern[j] - '0'; ++k) {
+                modules.append(j % 2 == 0);
+            }
+        }
+    }
+
+    barcode.setModules(QSize(modules.count(), 1), modules);
+    return barcode;
+}
+
+// Multiply in GF(2^8) modulo x^8 + x^4 + x^3 + x^2 + 1
+static quint8 gfMultiply(quint8 x, quint8 y)
+{
+    int z = 0;
+    for (int i = 7; i >= 0; --i) {
+        z = (z << 1) ^ ((z >> 7) * 0x11D);
+        z ^= ((y >> i) & 1) * x;
+    }
+    return static_cast<quint8>(z);
+}
+
+static QByteArray reedSolomonDivisor(int degree)
+{
+    QByteArray result(degree, 0);
+    result[degree - 1] = 1;
+
+    // Multiply together (x - r^0) (x - r^1) ... (x - r^(degree - 1))
+    quint8 root = 1;
+    for (int i = 0; i < degree; ++i) {
+        for (int j = 0; j < degree; ++j) {
+            result[j] = gfMultiply(result.at(j), root);
+            if (j + 1 < degree) {
+                result[j] = result.at(j) ^ result.at(j + 1);
+            }
+        }
+        root = gfMultiply(root, 0x02);
+    }
+    return result;
+}
+
+static QByteArray reedSolomonRemainder(const QByteArray &data, const QByteArray &divisor)
+{
+    QByteArray result(divisor.size(), 0);
+    foreach (char byte, data) {
+        quint8 factor = byte ^ result.at(0);
+        result.remove(0, 1);
+        result.append('\0');
+        for (int i = 0; i < result.size(); ++i) {
+            result[i] = result.at(i) ^ gfMultiply(divisor.at(i), factor);
+        }
+    }
+    return result;
+}
+
+static int qrRawDataModules(int version)
+{
+    int result = (16 * version + 128) * version + 64;
+    if (version >= 2) {
+        int alignCount = version / 7 + 2;
+        result -= (25 * alignCount - 10) * alignCount - 55;
+        if (version >= 7) {
+            result -= 36;
+        }
+    }
+    return result;
+}
+
+static int qrDataCodewords(int version)
+{
+    return qrRawDataModules(version) / 8 -
+            QrEccCodewordsPerBlock[version - 1] * QrEccBlocks[version - 1];
+}
+
+static QVector<int> qrAlignmentPositions(int version)
+{
+    QVector<int> positions;
+    if (version == 1) {
+        return positions;
+    }
+    int count = version / 7 + 2;
+    int step = version == 32 ? 26 : (version * 4 + count * 2 + 1) / (count * 2 - 2) * 2;
+    int size = version * 4 + 17;
+    positions.append(6);
+    for (int position = size - 7; positions.count() < count; position -= step) {
+        positions.insert(1, position);
+    }
+    return positions;
+}
+
+static void qrDrawFormatBits(QrMatrix &matrix, int mask)
+{
+    // Compute the BCH code for the error correction level and mask
+    int data = QrEccFormatBits << 3 | mask;
+    int remainder = data;
+    for (int i = 0; i < 10; ++i) {
+        remainder = (remainder << 1) ^ ((remainder >> 9) * 0x537);
+    }
+    int bits = (data << 10 | remainder) ^ 0x5412;
+
+    // First copy, around the top left finder
+    for (int i = 0; i <= 5; ++i) {
+        matrix.setFunction(8, i, (bits >> i) & 1);
+    }
+    matrix.setFunction(8, 7, (bits >> 6) & 1);
+    matrix.setFunction(8, 8, (bits >> 7) & 1);
+    matrix.setFunction(7, 8, (bits >> 8) & 1);
+    for (int i = 9; i < 15; ++i) {
+        matrix.setFunction(14 - i, 8, (bits >> i) & 1);
+    }
+
+    // Second copy, split between the other two finders
+    int size = matrix.size;
+    for (int i = 0; i < 8; ++i) {
+        matrix.setFunction(size - 1 - i, 8, (bits >> i) & 1);
+    }
+    for (int i = 8; i < 15; ++i) {
+        matrix.setFunction(8, size - 15 + i, (bits >> i) & 1);
+    }
+    matrix.setFunction(8, size - 8, true);
+}
+
+static void qrDrawFunctionPatterns(QrMatrix &matrix, int version)
+{
+    int size = matrix.size;
+
+    // Timing patterns
+    for (int i = 0; i < size; ++i) {
+        matrix.setFunction(6, i, i % 2 == 0);
+        matrix.setFunction(i, 6, i % 2 == 0);
+    }
+
+    // Finder patterns and their separators
+    const int finders[][2] = { { 3, 3 }, { size - 4, 3 }, { 3, size - 4 } };
+    for (const auto &finder : finders) {
+        for (int dy = -4; dy <= 4; ++dy) {
+            for (int dx = -4; dx <= 4; ++dx) {
+                int x = finder[0] + dx;
+                int y = finder[1] + dy;
+                if (x >= 0 && x < size && y >= 0 && y < size) {
+                    int distance = qMax(std::abs(dx), std::abs(dy));
+                    matrix.setFunction(x, y, distance != 2 && distance != 4);
+                }
+            }
+        }
+    }
+
+    // Alignment patterns, except where they would overlap the finders
+    QVector<int> positions = qrAlignmentPositions(version);
+    int last = positions.count() - 1;
+    for (int i = 0; i <= last; ++i) {
+        for (int j = 0; j <= last; ++j) {
+            if ((i == 0 && j == 0) || (i == 0 && j == last) || (i == last && j == 0)) {
+                continue;
+            }
+            for (int dy = -2; dy <= 2; ++dy) {
+                for (int dx = -2; dx <= 2; ++dx) {
+                    matrix.setFunction(
+                        positions.at(i) + dx,
+                        positions.at(j) + dy,
+                        qMax(std::abs(dx), std::abs(dy)) != 1
+                    );
+                }
+            }
+        }
+    }
+
+    // Reserve the format bits (drawn for real once the mask is known)
+    qrDrawFormatBits(matrix, 0);
+
+    // Version information for larger symbols
+    if (version >= 7) {
+        int remainder = version;
+        for (int i = 0; i < 12; ++i) {
+            remainder = (remainder << 1) ^ ((remainder >> 11) * 0x1F25);
+        }
+        int bits = version << 12 | remainder;
+        for (int i = 0; i < 18; ++i) {
+            bool dark = (bits >> i) & 1;
+            int a = size - 11 + i % 3;
+            int b = i / 3;
+            matrix.setFunction(a, b, dark);
+            matrix.setFunction(b, a, dark);
+        }
+    }
+}
+
+static void qrDrawCodewords(QrMatrix &matrix, const QByteArray &codewords)
+{
+    int size = matrix.size;
+    int bit = 0;
+    int bitCount = codewords.size() * 8;
+
+    // Fill pairs of columns from the right, zigzagging up and down and
+    // skipping the vertical timing pattern
+    for (int right = size - 1; right >= 1; right -= 2) {
+        if (right == 6) {
+            right = 5;
+        }
+        bool upward = ((right + 1) & 2) == 0;
+        for (int vertical = 0; vertical < size; ++vertical) {
+            int y = upward ? size - 1 - vertical : vertical;
+            for (int j = 0; j < 2; ++j) {
+                int x = right - j;
+                if (!matrix.isFunction(x, y) && bit < bitCount) {
+                    matrix.set(x, y, (codewords.at(bit >> 3) >> (7 - (bit & 7))) & 1);
+                    ++bit;
+                }
+            }
+        }
+    }
+}
+
+static bool qrMaskBit(int mask, int x, int y)
+{
+    switch (mask) {
+    case 0:
+        return (x + y) % 2 == 0;
+    case 1:
+        return y % 2 == 0;
+    case 2:
+        return x % 3 == 0;
+    case 3:
+        return (x + y) % 3 == 0;
+    case 4:
+        return (x / 3 + y / 2) % 2 == 0;
+    case 5:
+        return x * y % 2 + x * y % 3 == 0;
+    case 6:
+        return (x * y % 2 + x * y % 3) % 2 == 0;
+    default:
+        return ((x + y) % 2 + x * y % 3) % 2 == 0;
+    }
+}
+
+static void qrApplyMask(QrMatrix &matrix, int mask)
+{
+    for (int y = 0; y < matrix.size; ++y) {
+        for (int x = 0; x < matrix.size; ++x) {
+            if (!matrix.isFunction(x, y) && qrMaskBit(mask, x, y)) {
+                matrix.set(x, y, !matrix.get(x, y));
+            }
+        }
+    }
+}
+
+static int qrPenalty(const QrMatrix &matrix)
+{
+    int size = matrix.size;
+    int penalty = 0;
+
+    // Runs of five or more modules of the same color and patterns that look
+    // like finders, in both rows and columns
+    const bool finder[] = { 1, 0, 1, 1, 1, 0, 1, 0, 0, 0, 0 };
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < size; ++i) {
+            int run = 0;
+            bool previous = false;
+            for (int j = 0; j < size; ++j) {
+                bool dark = pass ? matrix.get(i, j) : matrix.get(j, i);
+                if (j && dark == previous) {
+                    ++run;
+                    if (run == 5) {
+                        penalty += 3;
+                    } else if (run > 5) {
+                        ++penalty;
+                    }
+                } else {
+                    run = 1;
+                    previous = dark;
+                }
+
+                if (j + 11 <= size) {
+                    bool forward = true;
+                    bool backward = true;
+                    for (int k = 0; k < 11; ++k) {
+                        bool module = pass ? matrix.get(i, j + k) : matrix.get(j + k, i);
+                        forward = forward && module == finder[k];
+                        backward = backward && module == finder[10 - k];
+                    }
+                    if (forward || backward) {
+                        penalty += 40;
+                    }
+                }
+            }
+        }
+    }
+
+    // Blocks of 2x2 modules of the same color
+    int dark = 0;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            bool color = matrix.get(x, y);
+            dark += color;
+            if (x + 1 < size && y + 1 < size &&
+                    color == matrix.get(x + 1, y) &&
+                    color == matrix.get(x, y + 1) &&
+                    color == matrix.get(x + 1, y + 1)) {
+                penalty += 3;
+            }
+        }
+    }
+
+    // Imbalance between dark and light modules
+    int total = size * size;
+    int k = (std::abs(dark * 20 - total * 10) + total - 1) / total - 1;
+    penalty += qMax(k, 0) * 10;
+
+    return penalty;
+}
+
+Barcode Barcode::encodeQrCode(const QByteArray &data)
+{
+    Barcode barcode;
+    barcode.mSymbology = QrCode;
+
+    // Find the smallest version that can hold the data in byte mode
+    int version = 1;
+    for (; version <= QrMaxVersion; ++version) {
+        int countBits = version <= 9 ? 8 : 16;
+        if (4 + countBits + data.size() * 8 <= qrDataCodewords(version) * 8) {
+            break;
+        }
+    }
+    if (version > QrMaxVersion) {
+        return barcode;
+    }
+
+    // Build the bit stream: mode, length, data, terminator and padding
+    int capacity = qrDataCodewords(version);
+    QByteArray codewords(capacity, 0);
+    int bit = 0;
+    auto append = [&codewords, &bit](int value, int length) {
+        for (int i = length - 1; i >= 0; --i, ++bit) {
+            if ((value >> i) & 1) {
+                codewords[bit >> 3] = codewords.at(bit >> 3) | (0x80 >> (bit & 7));
+            }
+        }
+    };
+    append(0x4, 4);
+    append(data.size(), version <= 9 ? 8 : 16);
+    foreach (char byte, data) {
+        append(static_cast<quint8>(byte), 8);
+    }
+    bit += qMin(4, capacity * 8 - bit);
+    bit = (bit + 7) / 8 * 8;
+    for (quint8 pad = 0xEC; bit < capacity * 8; pad ^= 0xEC ^ 0x11) {
+        append(pad, 8);
+    }
+
+    // Split into blocks, add error correction to each and interleave them
+    int blockCount = QrEccBlocks[version - 1];
+    int eccLength = QrEccCodewordsPerBlock[version - 1];
+    int rawCodewords = qrRawDataModules(version) / 8;
+    int shortBlockCount = blockCount - rawCodewords % blockCount;
+    int shortBlockLength = rawCodewords / blockCount;
+    QByteArray divisor = reedSolomonDivisor(eccLength);
+    QVector<QByteArray> blocks;
+    for (int i = 0, offset = 0; i < blockCount; ++i) {
+        int length = shortBlockLength - eccLength + (i < shortBlockCount ? 0 : 1);
+        QByteArray block = codewords.mid(offset, length);
+        offset += length;
+        QByteArray ecc = reedSolomonRemainder(block, divisor);
+        if (i < shortBlockCount) {
+            block.append('\0');
+        }
+        blocks.append(block + ecc);
+    }
+    QByteArray interleaved;
+    for (int i = 0; i < blocks.first().size(); ++i) {
+        for (int j = 0; j < blocks.count(); ++j) {
+            if (i != shortBlockLength - eccLength || j >= shortBlockCount) {
+                interleaved.append(blocks.at(j).at(i));
+            }
+        }
+    }
+
+    // Place everything and choose the mask that is easiest to scan
+    QrMatrix matrix(version);
+    qrDrawFunctionPatterns(matrix, version);
+    qrDrawCodewords(matrix, interleaved);
+    int bestMask = 0;
+    int bestPenalty = -1;
+    for (int mask = 0; mask < 8; ++mask) {
+        qrApplyMask(matrix, mask);
+        qrDrawFormatBits(matrix, mask);
+        int penalty = qrPenalty(matrix);
+        if (bestPenalty < 0 || penalty < bestPenalty) {
+            bestMask = mask;
+            bestPenalty = penalty;
+        }
+        qrApplyMask(matrix, mask);
+    }
+    qrApplyMask(matrix, bestMask);
+    qrDrawFormatBits(matrix, bestMask);
+
+    barcode.setModules(QSize(matrix.size, matrix.size), matrix.modules);
+    return barcode;
+}
+
+void Barcode::setModules(const QSize &size, const QVector<quint8> &modules)
+{
+    mSize = size;
+    mModules = modules;
+
+    // Merge horizontal runs of dark modules into single rects
+    mPath = QPainterPath();
+    mPath.setFillRule(Qt::WindingFill);
+    for (int y = 0; y < size.height(); ++y) {
+        int x = 0;
+        while (x < size.width()) {
+            if (!modules.at(y * size.width() + x)) {
+                ++x;
+                continue;
+            }
+            int start = x;
+            while (x < size.width() && modules.at(y * size.width() + x)) {
+                ++x;
+            }
+            mPath.addRect(start, y, x - start, 1);
+        }
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef BARCODE_H
+#define BARCODE_H
+
+#include <QByteArray>
+#include <QPainter>
+#include <QPainterPath>
+#include <QRectF>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+class Cell;
+
+/**
+ * @brief Encoded barcode symbol
+ *
+ * Symbols are encoded once for each payload and cached, since the same
+ * payload is usually drawn many times (in the preview, in each copy and in
+ * display lists). Dark modules are kept as a vector path, which is scaled to
+ * fit whatever rect the symbol is drawn in. Code 128 symbols are a single
+ * row of modules; QR codes use byte mode with medium error correction.
+ */
+class Barcode
+{
+public:
+
+    enum Symbology {
+        Code128,
+        QrCode
+    };
+
+    static QSharedPointer<const Barcode> get(Symbology symbology, const QString &payload);
+    static QSharedPointer<const Barcode> get(const Cell &cell);
+    static Barcode encode(Symbology symbology, const QString &payload);
+
+    bool isNull() const;
+
+    Symbology symbology() const;
+    QSize size() const;
+    bool module(int x, int y) const;
+
+    void draw(QPainter &painter, const QRectF &rect) const;
+
+private:
+
+    Barcode();
+
+    static Barcode encodeCode128(const QByteArray &data);
+    static Barcode encodeQrCode(const QByteArray &data);
+
+    void setModules(const QSize &size, const QVector<quint8> &modules);
+
+    Symbology mSymbology;
+    QSize mSize;
+    QVector<quint8> mModules;
+
+    // Dark modules, one unit per module
+    QPainterPath mPath;
+};
+
+#endif // BARCODE_H
@@ -0,0 +1,329 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstring>
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QJsonValue>
+
+#include "batchrunner.h"
+#include "imagesink.h"
+#include "mergeimporter.h"
+#include "nullsink.h"
+#include "outputsink.h"
+
+// Resolution of PNG output when none is specified
+const int DefaultDpi = 300;
+
+BatchRunner::BatchRunner()
+    : mErr(stderr),
+      mSheetCount(0),
+      mOutputFailed(false)
+{
+}
+
+BatchRunner::~BatchRunner()
+{
+    qDeleteAll(mSinks);
+}
+
+bool BatchRunner::isBatch(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--batch") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int BatchRunner::run(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Render and print box labels without the GUI.");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("batch", "Run without the GUI."));
+    parser.addOption(QCommandLineOption("printer", "Print to the named printer.", "name"));
+    parser.addOption(QCommandLineOption("raster", "Render pages for the printer as images, in parallel."));
+    parser.addOption(QCommandLineOption("pdf", "Write all sheets to a PDF file.", "file"));
+    parser.addOption(QCommandLineOption("png", "Write one PNG per page to a directory.", "directory"));
+    parser.addOption(QCommandLineOption("null", "Lay out sheets without writing them anywhere."));
+    parser.addOption(QCommandLineOption("dpi", "Resolution of PNG output.", "dpi", QString::number(DefaultDpi)));
+    parser.addOption(QCommandLineOption("merge", "Generate sheets from CSV / TSV records.", "file"));
+    parser.addOption(QCommandLineOption("template", "Sheet to fill in with each record.", "file"));
+    parser.addOption(QCommandLineOption("group-size", "Put this many records on each sheet.", "n", "1"));
+    parser.addOption(QCommandLineOption("group-by", "Put consecutive records with the same value on one sheet.", "column"));
+    parser.addPositionalArgument("files", "Sheet definitions to read (\"-\" for stdin).", "[files...]");
+
+    if (!parser.parse(arguments)) {
+        mErr << parser.errorText() << endl;
+        return UsageError;
+    }
+    if (parser.isSet("help")) {
+        mErr << parser.helpText();
+        return Success;
+    }
+
+    // At least one output is required
+    if (!parser.isSet("printer") && !parser.isSet("pdf") &&
+            !parser.isSet("png") && !parser.isSet("null")) {
+        mErr << "no output specified (use --printer, --pdf, --png or --null)" << endl;
+        return UsageError;
+    }
+
+    bool dpiOk;
+    int dpi = parser.value("dpi").toInt(&dpiOk);
+    if (!dpiOk || dpi <= 0) {
+        mErr << "invalid resolution: " << parser.value("dpi") << endl;
+        return UsageError;
+    }
+
+    if (parser.isSet("merge") && !parser.isSet("template")) {
+        mErr << "--merge requires --template" << endl;
+        return UsageError;
+    }
+
+    if (!openOutputs(parser, dpi)) {
+        return OutputError;
+    }
+    mTimer.start();
+
+    // Read the sheets, defaulting to stdin unless merging
+    QStringList filenames = parser.positionalArguments();
+    if (filenames.isEmpty() && !parser.isSet("merge")) {
+        filenames.append("-");
+    }
+    foreach (const QString &filename, filenames) {
+        if (!readSheets(filename)) {
+            return mOutputFailed ? OutputError : InputError;
+        }
+    }
+    if (parser.isSet("merge") && !mergeSheets(parser)) {
+        return mOutputFailed ? OutputError : InputError;
+    }
+
+    if (!closeOutputs()) {
+        return OutputError;
+    }
+
+    // Report throughput for each output
+    qint64 elapsed = qMax<qint64>(mTimer.elapsed(), 1);
+    foreach (OutputSink *sink, mSinks) {
+        mErr << sink->name() << ": " << mSheetCount << " sheets, "
+             << sink->pageCount() << " pages ("
+             << qRound(sink->pageCount() * 60000.0 / elapsed) << " pages/min)" << endl;
+    }
+
+    return Success;
+}
+
+bool BatchRunner::openFile(const QString &filename, QFile *file)
+{
+    bool opened;
+    if (filename == "-") {
+        opened = file->open(stdin, QIODevice::ReadOnly);
+    } else {
+        file->setFileName(filename);
+        opened = file->open(QIODevice::ReadOnly);
+    }
+    if (!opened) {
+        mErr << filename << ": " << file->errorString() << endl;
+    }
+    return opened;
+}
+
+bool BatchRunner::readSheets(const QString &filename)
+{
+    QFile file;
+    if (!openFile(filename, &file)) {
+        return false;
+    }
+    QByteArray data = file.readAll();
+
+    // Try the whole document first
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(data, &error);
+    if (error.error == QJsonParseError::NoError) {
+        if (document.isObject()) {
+            return readSheet(document.object(), filename);
+        }
+        QJsonArray array = document.array();
+        for (int i = 0; i < array.count(); ++i) {
+            if (!readSheet(array.at(i), QString("%1: sheet %2").arg(filename).arg(i))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Fall back to one object per line
+    QList<QByteArray> lines = data.split('\n');
+    for (int i = 0; i < lines.count(); ++i) {
+        QByteArray line = lines.at(i).trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        document = QJsonDocument::fromJson(line, &error);
+        if (error.error != QJsonParseError::NoError) {
+            mErr << filename << ":" << i + 1 << ": invalid sheet: "
+                 << error.errorString() << endl;
+            return false;
+        }
+        if (!readSheet(document.object(), QString("%1:%2").arg(filename).arg(i + 1))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool BatchRunner::readSheet(const QJsonValue &value, const QString &location)
+{
+    // Anything that isn't an object is read as an empty one
+    QString errorString;
+    QJsonObject object = value.toObject();
+    if (!Sheet::validate(object, &errorString)) {
+        mErr << location << ": invalid sheet: " << errorString << endl;
+        return false;
+    }
+
+    return writeSheet(Sheet::fromJson(object));
+}
+
+bool BatchRunner::mergeSheets(const QCommandLineParser &parser)
+{
+    // Load the template
+    QFile templateFile;
+    if (!openFile(parser.value("template"), &templateFile)) {
+        return false;
+    }
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(templateFile.readAll(), &error);
+    if (!document.isObject()) {
+        mErr << parser.value("template") << ": invalid template: "
+             << error.errorString() << endl;
+        return false;
+    }
+
+    bool groupSizeOk;
+    int groupSize = parser.value("group-size").toInt(&groupSizeOk);
+    if (!groupSizeOk || groupSize <= 0) {
+        mErr << "invalid group size: " << parser.value("group-size") << endl;
+        return false;
+    }
+
+    // Open the records
+    QString filename = parser.value("merge");
+    QFile file;
+    if (!openFile(filename, &file)) {
+        return false;
+    }
+
+    MergeImporter importer(&file, Sheet::fromJson(document.object()),
+                           MergeImporter::delimiterFor(filename));
+    importer.setGroupSize(groupSize);
+    importer.setGroupColumn(parser.value("group-by"));
+
+    // Write each sheet as soon as it is generated
+    Sheet sheet;
+    while (importer.next(&sheet)) {
+        if (!writeSheet(sheet)) {
+            return false;
+        }
+    }
+    if (!importer.errorString().isEmpty()) {
+        mErr << filename << ": " << importer.errorString() << endl;
+        return false;
+    }
+
+    mErr << "merged " << importer.recordCount() << " records into "
+         << importer.sheetCount() << " sheets ("
+         << qRound(importer.recordsPerSecond()) << " records/s)" << endl;
+
+    return true;
+}
+
+bool BatchRunner::openOutputs(const QCommandLineParser &parser, int dpi)
+{
+    QStringList destinations;
+    if (parser.isSet("printer")) {
+        destinations.append(QString("%1:%2")
+                            .arg(parser.isSet("raster") ? "raster" : "printer")
+                            .arg(parser.value("printer")));
+    }
+    if (parser.isSet("pdf")) {
+        destinations.append(QString("pdf:%1").arg(parser.value("pdf")));
+    }
+    foreach (const QString &destination, destinations) {
+        QString errorString;
+        OutputSink *sink = OutputSink::create(destination, &errorString);
+        if (!sink) {
+            mErr << errorString << endl;
+            return false;
+        }
+        mSinks.append(sink);
+    }
+
+    if (parser.isSet("png")) {
+        mSinks.append(new ImageSink(parser.value("png"), dpi));
+    }
+    if (parser.isSet("null")) {
+        mSinks.append(new NullSink);
+    }
+
+    return true;
+}
+
+bool BatchRunner::writeSheet(const Sheet &sheet)
+{
+    ++mSheetCount;
+
+    foreach (OutputSink *sink, mSinks) {
+        if (!sink->write(sheet)) {
+            mErr << sink->name() << ": " << sink->errorString() << endl;
+            mOutputFailed = true;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool BatchRunner::closeOutputs()
+{
+    bool ok = true;
+    foreach (OutputSink *sink, mSinks) {
+        if (!sink->finish()) {
+            mErr << sink->name() << ": " << sink->errorString() << endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
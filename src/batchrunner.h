@@ -0,0 +1,87 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <QElapsedTimer>
+#include <QJsonValue>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+#include "sheet.h"
+
+class QCommandLineParser;
+class QFile;
+
+class OutputSink;
+
+/**
+ * @brief Render and print sheets from the command line without any widgets
+ *
+ * Sheets are read as JSON - a single object, an array of objects or one
+ * object per line - from files or stdin, or merged from CSV / TSV records.
+ * Each sheet is sent to the output sinks as soon as it is read.
+ */
+class BatchRunner
+{
+public:
+
+    enum {
+        Success = 0,
+        UsageError = 1,
+        InputError = 2,
+        OutputError = 3
+    };
+
+    BatchRunner();
+    ~BatchRunner();
+
+    static bool isBatch(int argc, char **argv);
+
+    int run(const QStringList &arguments);
+
+private:
+
+    bool openFile(const QString &filename, QFile *file);
+    bool readSheets(const QString &filename);
+    bool readSheet(const QJsonValue &value, const QString &location);
+    bool mergeSheets(const QCommandLineParser &parser);
+
+    bool openOutputs(const QCommandLineParser &parser, int dpi);
+    bool writeSheet(const Sheet &sheet);
+    bool closeOutputs();
+
+    QTextStream mErr;
+
+    QList<OutputSink*> mSinks;
+    QElapsedTimer mTimer;
+
+    int mSheetCount;
+    bool mOutputFailed;
+};
+
+#endif // BATCHRUNNER_H
@@ -25,6 +25,7 @@
 #include "cell.h"
 
 Cell::Cell()
+    : mType(Text)
 {
 }
 
@@ -37,3 +38,13 @@ void Cell::setText(const QString &text)
 {
     mText = text;
 }
+
+Cell::Type Cell::type() const
+{
+    return mType;
+}
+
+void Cell::setType(Type type)
+{
+    mType = type;
+}
@@ -29,19 +29,31 @@
 
 /**
  * @brief Storage for cell text and metadata
+ *
+ * The text of a barcode cell is its payload.
  */
 class Cell
 {
 public:
 
+    enum Type {
+        Text,
+        Code128,
+        QrCode
+    };
+
     Cell();
 
     QString text() const;
     void setText(const QString &text);
 
+    Type type() const;
+    void setType(Type type);
+
 private:
 
     QString mText;
+    Type mType;
 };
 
 #endif // CELL_H
@@ -0,0 +1,204 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QImage>
+#include <QList>
+#include <QPair>
+#include <QPen>
+
+#include "barcode.h"
+#include "displaylist.h"
+#include "fitcache.h"
+#include "fitengine.h"
+#include "sheet.h"
+#include "sheetlayout.h"
+
+// Resolution text is fitted at, matching that used for printing
+const int ReferenceDpi = 1200;
+
+// Points per inch, which is the resolution of the logical coordinates
+const int PointsPerInch = 72;
+
+DisplayList::DisplayList()
+    : mBorder(0)
+{
+}
+
+DisplayList DisplayList::compile(const Sheet &sheet, const QSize &size, const DisplayList *previous)
+{
+    DisplayList list;
+    list.mSize = size;
+    list.mFont = sheet.font;
+    list.mBorder = sheet.border;
+
+    // Ensure non-zero rows and columns
+    if (!sheet.rows() || !sheet.cols()) {
+        return list;
+    }
+
+    // Measure on a device at the reference resolution mapped exactly as a
+    // printer page would be
+    int dotsPerMeter = qRound(ReferenceDpi / 0.0254);
+    QImage measureImage(1, 1, QImage::Format_RGB32);
+    measureImage.setDotsPerMeterX(dotsPerMeter);
+    measureImage.setDotsPerMeterY(dotsPerMeter);
+
+    QPainter painter(&measureImage);
+    painter.setWindow(0, 0, size.width(), size.height());
+    painter.setViewport(
+        0,
+        0,
+        size.width() * ReferenceDpi / PointsPerInch,
+        size.height() * ReferenceDpi / PointsPerInch
+    );
+    FitEngine engine(painter, FitCache::instance());
+    QSharedPointer<const SheetLayout> layout = SheetLayout::get(sheet, size);
+
+    // The header and footer can only be reused with the same font
+    bool canReuse = previous && previous->mSize == size && previous->mFont == sheet.font;
+
+    // Resolve the header and footer
+    QList<QPair<QRectF, QString>> staticText;
+    if (!sheet.headerText.isEmpty()) {
+        staticText.append(qMakePair(layout->headerRect(), sheet.headerText));
+    }
+    if (!sheet.footerText.isEmpty()) {
+        staticText.append(qMakePair(layout->footerRect(), sheet.footerText));
+    }
+    bool reused = canReuse && previous->mStaticItems.count() == staticText.count();
+    for (int i = 0; reused && i < staticText.count(); ++i) {
+        const TextItem &item = previous->mStaticItems.at(i);
+        reused = item.rect == staticText.at(i).first && item.text == staticText.at(i).second;
+    }
+    if (reused) {
+        list.mStaticItems = previous->mStaticItems;
+    } else {
+        for (int i = 0; i < staticText.count(); ++i) {
+            TextItem item;
+            item.rect = staticText.at(i).first;
+            item.text = staticText.at(i).second;
+            item.pointSize = engine.fit(sheet.font, item.rect, item.text);
+            list.mStaticItems.append(item);
+        }
+    }
+
+    // Resolve each cell
+    const QVector<QRectF> &rects = layout->cellRects();
+    const QVector<Cell> &cells = sheet.cells();
+    list.mCellItems.reserve(cells.count());
+    for (int i = 0; i < cells.count(); ++i) {
+
+        // Barcodes are already encoded as paths
+        QSharedPointer<const Barcode> barcode = Barcode::get(cells.at(i));
+        if (barcode) {
+            BarcodeItem item;
+            item.rect = rects.at(i);
+            item.barcode = barcode;
+            list.mBarcodeItems.append(item);
+            continue;
+        }
+
+        TextItem item;
+        item.rect = rects.at(i);
+        item.text = cells.at(i).text();
+        item.pointSize = engine.fit(sheet.font, item.rect, item.text);
+        list.mCellItems.append(item);
+    }
+
+    return list;
+}
+
+bool DisplayList::isEmpty() const
+{
+    return mCellItems.isEmpty() && mBarcodeItems.isEmpty();
+}
+
+QSize DisplayList::size() const
+{
+    return mSize;
+}
+
+void DisplayList::draw(QPaintDevice *device) const
+{
+    if (isEmpty()) {
+        return;
+    }
+
+    QPainter painter(device);
+    draw(painter);
+}
+
+void DisplayList::draw(QPainter &painter) const
+{
+    // Map the logical size onto the whole device
+    QPaintDevice *device = painter.device();
+    draw(painter, QRect(0, 0, device->width(), device->height()));
+}
+
+void DisplayList::draw(QPainter &painter, const QRect &viewport) const
+{
+    if (isEmpty()) {
+        return;
+    }
+
+    // Map the logical size onto the viewport, which may extend beyond the
+    // device when only a part of the page is being drawn
+    painter.save();
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setWindow(0, 0, mSize.width(), mSize.height());
+    painter.setViewport(viewport);
+
+    // Fonts are resolved against the device's logical resolution before the
+    // view transform is applied, so sizes fitted at the reference resolution
+    // must be scaled to this device's
+    qreal scale = static_cast<qreal>(ReferenceDpi) / painter.device()->logicalDpiY();
+
+    // Draw the border
+    if (mBorder) {
+        auto halfBorder = mBorder / 2;
+        painter.setPen(QPen(Qt::black, mBorder, Qt::SolidLine, Qt::SquareCap, Qt::MiterJoin));
+        painter.drawRect(halfBorder, halfBorder, mSize.width() - mBorder, mSize.height() - mBorder);
+    }
+
+    drawItems(painter, mStaticItems, scale);
+    drawItems(painter, mCellItems, scale);
+    foreach (const BarcodeItem &item, mBarcodeItems) {
+        item.barcode->draw(painter, item.rect);
+    }
+
+    painter.restore();
+}
+
+void DisplayList::drawItems(QPainter &painter, const QVector<TextItem> &items, qreal scale) const
+{
+    QFont font = mFont;
+    foreach (const TextItem &item, items) {
+        if (!item.pointSize) {
+            continue;
+        }
+        font.setPointSizeF(item.pointSize * scale);
+        painter.setFont(font);
+        painter.drawText(item.rect, Qt::AlignVCenter, item.text);
+    }
+}
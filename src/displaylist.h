@@ -0,0 +1,92 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef DISPLAYLIST_H
+#define DISPLAYLIST_H
+
+#include <QFont>
+#include <QPaintDevice>
+#include <QPainter>
+#include <QRect>
+#include <QRectF>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+class Barcode;
+class Sheet;
+
+/**
+ * @brief Sheet compiled into resolved drawing operations
+ *
+ * All geometry is resolved and all text fitted when the list is compiled,
+ * so replaying it onto a device of any resolution involves no measuring.
+ * Compiling with a previous list reuses its border, header and footer when
+ * they are unchanged.
+ */
+class DisplayList
+{
+public:
+
+    DisplayList();
+
+    static DisplayList compile(const Sheet &sheet, const QSize &size,
+                               const DisplayList *previous = nullptr);
+
+    bool isEmpty() const;
+    QSize size() const;
+
+    void draw(QPaintDevice *device) const;
+    void draw(QPainter &painter) const;
+    void draw(QPainter &painter, const QRect &viewport) const;
+
+private:
+
+    struct TextItem
+    {
+        QRectF rect;
+        int pointSize;
+        QString text;
+    };
+
+    struct BarcodeItem
+    {
+        QRectF rect;
+        QSharedPointer<const Barcode> barcode;
+    };
+
+    void drawItems(QPainter &painter, const QVector<TextItem> &items, qreal scale) const;
+
+    QSize mSize;
+    QFont mFont;
+    int mBorder;
+
+    // Header and footer, which often stay the same from sheet to sheet
+    QVector<TextItem> mStaticItems;
+    QVector<TextItem> mCellItems;
+    QVector<BarcodeItem> mBarcodeItems;
+};
+
+#endif // DISPLAYLIST_H
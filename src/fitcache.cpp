@@ -0,0 +1,183 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "fitcache.h"
+
+// Identifies snapshot files and their layout
+const quint32 SnapshotMagic = 0x42464300;
+const quint32 SnapshotVersion = 2;
+
+// Rect sizes are stored in 1/16ths of a logical unit and resolutions in
+// 1/100ths of a DPI to absorb floating point noise
+const int SizeScale = 16;
+const int DpiScale = 100;
+
+FitCache::FitCache(int maxEntries)
+    : mCache(maxEntries),
+      mHits(0),
+      mMisses(0)
+{
+}
+
+FitCache *FitCache::instance()
+{
+    static FitCache cache;
+    return &cache;
+}
+
+bool FitCache::lookup(const QFont &font, const QRectF &rect, const QString &text,
+                      qreal dpiX, qreal dpiY, int *size)
+{
+    Key key = makeKey(font, rect, text, dpiX, dpiY);
+
+    QMutexLocker locker(&mMutex);
+    int *cachedSize = mCache.object(key);
+    if (!cachedSize) {
+        ++mMisses;
+        return false;
+    }
+    ++mHits;
+    *size = *cachedSize;
+    return true;
+}
+
+void FitCache::insert(const QFont &font, const QRectF &rect, const QString &text,
+                      qreal dpiX, qreal dpiY, int size)
+{
+    Key key = makeKey(font, rect, text, dpiX, dpiY);
+
+    QMutexLocker locker(&mMutex);
+    mCache.insert(key, new int(size));
+}
+
+void FitCache::setMaxEntries(int maxEntries)
+{
+    QMutexLocker locker(&mMutex);
+    mCache.setMaxCost(maxEntries);
+}
+
+void FitCache::clear()
+{
+    QMutexLocker locker(&mMutex);
+    mCache.clear();
+    mHits = 0;
+    mMisses = 0;
+}
+
+quint64 FitCache::hits() const
+{
+    QMutexLocker locker(&mMutex);
+    return mHits;
+}
+
+quint64 FitCache::misses() const
+{
+    QMutexLocker locker(&mMutex);
+    return mMisses;
+}
+
+bool FitCache::load(const QString &filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_7);
+
+    // Reject snapshots from other versions rather than guessing
+    quint32 magic, version, count;
+    stream >> magic >> version >> count;
+    if (stream.status() != QDataStream::Ok ||
+            magic != SnapshotMagic || version != SnapshotVersion) {
+        return false;
+    }
+
+    QMutexLocker locker(&mMutex);
+    for (quint32 i = 0; i < count; ++i) {
+        Key key;
+        qint32 size;
+        stream >> key.font >> key.text >> key.width >> key.height
+               >> key.dpiX >> key.dpiY >> size;
+        if (stream.status() != QDataStream::Ok) {
+            return false;
+        }
+        mCache.insert(key, new int(size));
+    }
+
+    return true;
+}
+
+bool FitCache::save(const QString &filename) const
+{
+    QDir().mkpath(QFileInfo(filename).absolutePath());
+
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_7);
+
+    {
+        QMutexLocker locker(&mMutex);
+        QList<Key> keys = mCache.keys();
+        stream << SnapshotMagic << SnapshotVersion << static_cast<quint32>(keys.count());
+        foreach (const Key &key, keys) {
+            stream << key.font << key.text << key.width << key.height
+                   << key.dpiX << key.dpiY << static_cast<qint32>(*mCache[key]);
+        }
+    }
+
+    return file.commit();
+}
+
+QString FitCache::defaultFilename()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+            .filePath("fitcache");
+}
+
+FitCache::Key FitCache::makeKey(const QFont &font, const QRectF &rect, const QString &text,
+                                qreal dpiX, qreal dpiY)
+{
+    Key key;
+    key.font = font.key();
+    key.text = text;
+    key.width = qRound(rect.width() * SizeScale);
+    key.height = qRound(rect.height() * SizeScale);
+    key.dpiX = qRound(dpiX * DpiScale);
+    key.dpiY = qRound(dpiY * DpiScale);
+    return key;
+}
@@ -0,0 +1,103 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef FITCACHE_H
+#define FITCACHE_H
+
+#include <QCache>
+#include <QFont>
+#include <QHash>
+#include <QMutex>
+#include <QRectF>
+#include <QString>
+
+/**
+ * @brief Bounded LRU cache of fitted font sizes
+ *
+ * Entries are keyed by font, text, rect size and the logical resolution of
+ * the painter's device (which fonts are resolved against), so a size fitted
+ * for the preview is never reused for a printer (and vice versa). The cache
+ * is safe to use from multiple threads.
+ */
+class FitCache
+{
+public:
+
+    explicit FitCache(int maxEntries = 10000);
+
+    static FitCache *instance();
+
+    bool lookup(const QFont &font, const QRectF &rect, const QString &text,
+                qreal dpiX, qreal dpiY, int *size);
+    void insert(const QFont &font, const QRectF &rect, const QString &text,
+                qreal dpiX, qreal dpiY, int size);
+
+    void setMaxEntries(int maxEntries);
+    void clear();
+
+    quint64 hits() const;
+    quint64 misses() const;
+
+    bool load(const QString &filename);
+    bool save(const QString &filename) const;
+
+    static QString defaultFilename();
+
+private:
+
+    struct Key
+    {
+        QString font;
+        QString text;
+        int width;
+        int height;
+        int dpiX;
+        int dpiY;
+
+        bool operator==(const Key &other) const
+        {
+            return width == other.width && height == other.height &&
+                    dpiX == other.dpiX && dpiY == other.dpiY &&
+                    text == other.text && font == other.font;
+        }
+
+        friend uint qHash(const Key &key, uint seed = 0)
+        {
+            return qHash(key.text, seed) ^ qHash(key.font, seed) ^
+                    qHash(key.width, seed) ^ qHash(key.height << 16, seed) ^
+                    qHash(key.dpiX ^ (key.dpiY << 16), seed);
+        }
+    };
+
+    static Key makeKey(const QFont &font, const QRectF &rect, const QString &text,
+                       qreal dpiX, qreal dpiY);
+
+    mutable QMutex mMutex;
+    QCache<Key, int> mCache;
+
+    quint64 mHits;
+    quint64 mMisses;
+};
+
+#endif // FITCACHE_H
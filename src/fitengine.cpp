@@ -0,0 +1,163 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cmath>
+
+#include <QPaintDevice>
+
+#include "fitcache.h"
+#include "fitengine.h"
+
+// Size used for the initial measurement
+const int ReferenceSize = 72;
+
+FitEngine::FitEngine(QPainter &painter, FitCache *cache)
+    : mPainter(painter),
+      mCache(cache),
+      mDpiX(0),
+      mDpiY(0),
+      mMeasurements(0),
+      mTotalMeasurements(0)
+{
+    // Fonts are resolved against the device's logical resolution before the
+    // painter's transform is applied, so that is what the fitted size
+    // depends on
+    if (mCache && mPainter.device()) {
+        mDpiX = mPainter.device()->logicalDpiX();
+        mDpiY = mPainter.device()->logicalDpiY();
+    }
+}
+
+int FitEngine::fit(const QFont &font, const QRectF &rect, const QString &text)
+{
+    mMeasurements = 0;
+
+    // Use the cached size if the text was fitted before
+    int size;
+    if (mCache && mCache->lookup(font, rect, text, mDpiX, mDpiY, &size)) {
+        return size;
+    }
+
+    size = measure(font, rect, text);
+    if (mCache) {
+        mCache->insert(font, rect, text, mDpiX, mDpiY, size);
+    }
+
+    mTotalMeasurements += mMeasurements;
+
+    return size;
+}
+
+int FitEngine::measurements() const
+{
+    return mMeasurements;
+}
+
+int FitEngine::totalMeasurements() const
+{
+    return mTotalMeasurements;
+}
+
+int FitEngine::measure(const QFont &font, const QRectF &rect, const QString &text)
+{
+    // The rect height is the largest size ever tried
+    int maxSize = static_cast<int>(rect.height());
+    if (maxSize <= 0 || rect.width() <= 0) {
+        return 0;
+    }
+
+    QFont trialFont = font;
+
+    // Sizes known to fit (lo) and known not to fit (hi)
+    int lo = 0;
+    int hi = maxSize + 1;
+
+    // Measure the text once at the reference size
+    int refSize = qMin(maxSize, ReferenceSize);
+    trialFont.setPointSize(refSize);
+    mPainter.setFont(trialFont);
+    QRectF refRect = mPainter.boundingRect(rect, 0, text);
+    ++mMeasurements;
+    if (refRect.width() <= rect.width() && refRect.height() <= rect.height()) {
+        lo = refSize;
+    } else {
+        hi = refSize;
+    }
+
+    // Text dimensions scale (roughly) linearly with point size, so predict
+    // the size at which the tighter of the two dimensions just fits
+    int guess = maxSize;
+    if (refRect.width() > 0 && refRect.height() > 0) {
+        qreal scale = qMin(rect.width() / refRect.width(),
+                           rect.height() / refRect.height());
+        guess = qBound(1, static_cast<int>(std::floor(refSize * scale)), maxSize);
+    }
+
+    // Gallop away from the guess until the answer is bracketed
+    if (guess > lo && guess < hi) {
+        if (fits(trialFont, guess, rect, text)) {
+            lo = guess;
+            for (int step = 1; lo + step < hi; step *= 2) {
+                if (fits(trialFont, lo + step, rect, text)) {
+                    lo += step;
+                } else {
+                    hi = lo + step;
+                    break;
+                }
+            }
+        } else {
+            hi = guess;
+            for (int step = 1; hi - step > lo; step *= 2) {
+                if (fits(trialFont, hi - step, rect, text)) {
+                    lo = hi - step;
+                    break;
+                } else {
+                    hi -= step;
+                }
+            }
+        }
+    }
+
+    // Narrow the remaining range with a binary search
+    while (hi - lo > 1) {
+        int mid = lo + (hi - lo) / 2;
+        if (fits(trialFont, mid, rect, text)) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+bool FitEngine::fits(QFont &font, int size, const QRectF &rect, const QString &text)
+{
+    font.setPointSize(size);
+    mPainter.setFont(font);
+    QRectF requiredRect = mPainter.boundingRect(rect, 0, text);
+    ++mMeasurements;
+    return requiredRect.width() <= rect.width() &&
+            requiredRect.height() <= rect.height();
+}
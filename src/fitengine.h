@@ -0,0 +1,70 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef FITENGINE_H
+#define FITENGINE_H
+
+#include <QFont>
+#include <QPainter>
+#include <QRectF>
+#include <QString>
+
+class FitCache;
+
+/**
+ * @brief Find the largest point size at which text fits in a rect
+ *
+ * The text is measured once at a reference size and the result is used to
+ * predict the fitting size, which is then refined with a short search. The
+ * painter is used for all measurements so that results match what would be
+ * drawn on its device. If a cache is provided, it is consulted before any
+ * measuring is done and updated with each new result.
+ */
+class FitEngine
+{
+public:
+
+    explicit FitEngine(QPainter &painter, FitCache *cache = nullptr);
+
+    int fit(const QFont &font, const QRectF &rect, const QString &text);
+
+    int measurements() const;
+    int totalMeasurements() const;
+
+private:
+
+    int measure(const QFont &font, const QRectF &rect, const QString &text);
+    bool fits(QFont &font, int size, const QRectF &rect, const QString &text);
+
+    QPainter &mPainter;
+    FitCache *mCache;
+
+    qreal mDpiX;
+    qreal mDpiY;
+
+    int mMeasurements;
+    int mTotalMeasurements;
+};
+
+#endif // FITENGINE_H
@@ -0,0 +1,129 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QChar>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPageSize>
+#include <QStringList>
+
+#include "imagesink.h"
+#include "sheet.h"
+
+// Number of the last page written to each directory (by canonical path),
+// shared by every sink writing there
+static QMutex imageNumberMutex;
+static QHash<QString, int> lastImageNumbers;
+
+ImageSink::ImageSink(const QString &directory, int dpi)
+    : OutputSink(QString("png:%1").arg(directory)),
+      mDirectory(directory),
+      mDpi(dpi),
+      mScanned(false)
+{
+}
+
+QSize ImageSink::pageSize(int orientation)
+{
+    // Lay out the page in points, as is done when printing
+    QSize size = QPageSize(QPageSize::Letter).sizePoints();
+    if (orientation == Sheet::Landscape) {
+        size.transpose();
+    }
+    return size;
+}
+
+bool ImageSink::drawPage(const DisplayList &displayList)
+{
+    if (!mScanned && !scanDirectory()) {
+        return false;
+    }
+
+    // The display list is laid out for the page's orientation
+    QSize imageSize = QPageSize(QPageSize::Letter).sizePixels(mDpi);
+    if (displayList.size().width() > displayList.size().height()) {
+        imageSize.transpose();
+    }
+
+    int dotsPerMeter = qRound(mDpi / 0.0254);
+    QImage image(imageSize, QImage::Format_RGB32);
+    image.setDotsPerMeterX(dotsPerMeter);
+    image.setDotsPerMeterY(dotsPerMeter);
+    image.fill(Qt::white);
+    displayList.draw(&image);
+
+    int number;
+    {
+        QMutexLocker locker(&imageNumberMutex);
+        number = ++lastImageNumbers[mPath];
+    }
+    QString filename = QDir(mDirectory).filePath(
+        QString("page-%1.png").arg(number, 6, 10, QChar('0'))
+    );
+    if (QFile::exists(filename)) {
+        setErrorString(QString("%1 already exists").arg(filename));
+        return false;
+    }
+    if (!image.save(filename, "PNG")) {
+        setErrorString(QString("unable to write %1").arg(filename));
+        return false;
+    }
+    ++mPageCount;
+
+    return true;
+}
+
+bool ImageSink::scanDirectory()
+{
+    if (!QDir().mkpath(mDirectory)) {
+        setErrorString(QString("unable to create %1").arg(mDirectory));
+        return false;
+    }
+
+    // The same directory may be named more than one way
+    mPath = QDir(mDirectory).canonicalPath();
+
+    // Find the highest numbered page written by an earlier run, unless
+    // another sink is already writing to the directory
+    QMutexLocker locker(&imageNumberMutex);
+    if (!lastImageNumbers.contains(mPath)) {
+        int highest = 0;
+        QStringList filenames = QDir(mDirectory).entryList(QStringList() << "page-*.png", QDir::Files);
+        foreach (const QString &filename, filenames) {
+            bool ok;
+            int number = filename.mid(5, filename.length() - 9).toInt(&ok);
+            if (ok) {
+                highest = qMax(highest, number);
+            }
+        }
+        lastImageNumbers.insert(mPath, highest);
+    }
+
+    mScanned = true;
+    return true;
+}
@@ -0,0 +1,59 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef IMAGESINK_H
+#define IMAGESINK_H
+
+#include <QString>
+
+#include "outputsink.h"
+
+/**
+ * @brief Sink that writes each page to a PNG file in a directory
+ *
+ * Files are numbered in the order pages are drawn to the directory, so
+ * several sinks may share it. Numbering continues after the highest
+ * numbered page already in the directory and existing files are never
+ * overwritten.
+ */
+class ImageSink : public OutputSink
+{
+public:
+
+    explicit ImageSink(const QString &directory, int dpi = 300);
+
+    virtual QSize pageSize(int orientation);
+    virtual bool drawPage(const DisplayList &displayList);
+
+private:
+
+    bool scanDirectory();
+
+    QString mDirectory;
+    QString mPath;
+    int mDpi;
+    bool mScanned;
+};
+
+#endif // IMAGESINK_H
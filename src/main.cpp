@@ -23,15 +23,143 @@
  */
 
 #include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QGuiApplication>
+#include <QThread>
+#include <QTimer>
 
+#include "batchrunner.h"
+#include "fitcache.h"
 #include "mainwindow.h"
+#include "printerregistry.h"
+#include "printspool.h"
+#include "queuewidget.h"
+#include "startuptrace.h"
+#include "submissionserver.h"
+
+static int runBatch(int argc, char **argv)
+{
+    // No widgets are created, so there is no need for a display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QGuiApplication app(argc, argv);
+
+    FitCache::instance()->load(FitCache::defaultFilename());
+    int ret = BatchRunner().run(app.arguments());
+    FitCache::instance()->save(FitCache::defaultFilename());
+
+    return ret;
+}
 
 int main(int argc, char **argv)
 {
+    if (BatchRunner::isBatch(argc, argv)) {
+        return runBatch(argc, argv);
+    }
+
+    // Start timing as early as possible
+    StartupTrace *trace = StartupTrace::instance();
+    trace->mark("main");
+
     QApplication app(argc, argv);
+    trace->mark("application created");
+
+    // Allow the print queue to be tuned
+    QCommandLineParser parser;
+    QCommandLineOption workersOption("workers", "Number of print worker threads.", "n");
+    QCommandLineOption jobSizeOption("job-size", "Most sheets to combine into one print job.", "n");
+    QCommandLineOption jobWindowOption("job-window", "Time to wait for more sheets before printing (in ms).", "ms");
+    QCommandLineOption outputOption("output", "Destination for printed sheets (printer:NAME, raster:NAME, pdf:FILE, png:DIRECTORY or null).", "destination");
+    QCommandLineOption listenOption("listen", "Accept jobs from other programs on a local socket.", "name");
+    QCommandLineOption metricsOption("metrics", "File to write queue metrics to (.json for JSON, otherwise Prometheus text).", "file");
+    QCommandLineOption metricsIntervalOption("metrics-interval", "Time between writes of the metrics file (in ms).", "ms", "10000");
+    QCommandLineOption spoolOption("spool", "File that queued sheets are kept in.", "file", PrintSpool::defaultFilename());
+    QCommandLineOption traceStartupOption("trace-startup", "Log the time taken by each phase of starting up.");
+    QCommandLineOption tracePreviewOption("trace-preview", "Log the time from each edit to the updated preview.");
+    QCommandLineOption printerRefreshOption("printer-refresh", "Time between refreshes of the list of printers (in ms).", "ms", "60000");
+    parser.addOption(workersOption);
+    parser.addOption(jobSizeOption);
+    parser.addOption(jobWindowOption);
+    parser.addOption(outputOption);
+    parser.addOption(listenOption);
+    parser.addOption(metricsOption);
+    parser.addOption(metricsIntervalOption);
+    parser.addOption(spoolOption);
+    parser.addOption(printerRefreshOption);
+    parser.addOption(traceStartupOption);
+    parser.addOption(tracePreviewOption);
+    parser.process(app);
+    trace->setEnabled(parser.isSet(traceStartupOption));
+    int workerCount = QThread::idealThreadCount();
+    if (parser.isSet(workersOption)) {
+        workerCount = qMax(parser.value(workersOption).toInt(), 1);
+    }
+
+    MainWindow mainWindow(workerCount);
+    mainWindow.setTracePreview(parser.isSet(tracePreviewOption));
+    if (parser.isSet(jobSizeOption)) {
+        mainWindow.queueWidget()->setBatchSize(parser.value(jobSizeOption).toInt());
+    }
+    if (parser.isSet(jobWindowOption)) {
+        mainWindow.queueWidget()->setBatchWindow(parser.value(jobWindowOption).toInt());
+    }
+    if (parser.isSet(outputOption)) {
+        mainWindow.setDestination(parser.value(outputOption));
+    }
+    if (parser.isSet(metricsOption)) {
+        mainWindow.queueWidget()->setMetricsFile(
+            parser.value(metricsOption),
+            parser.value(metricsIntervalOption).toInt()
+        );
+    }
+
+    // Everything that isn't needed to show the window is started once it
+    // has been painted
+    SubmissionServer submissionServer(mainWindow.queueWidget());
+    QTimer printerRefreshTimer;
+    QObject::connect(trace, &StartupTrace::firstPaint, &mainWindow, [&]() {
+
+        // Find the printers (loading the print support plugin) in the
+        // background and keep the list up to date
+        PrinterRegistry::instance()->refreshAsync();
+        QObject::connect(&printerRefreshTimer, &QTimer::timeout, []() {
+            PrinterRegistry::instance()->refreshAsync();
+        });
+        printerRefreshTimer.start(qMax(parser.value(printerRefreshOption).toInt(), 1000));
+
+        // Warm the fit cache with sizes from previous runs and draw the
+        // first preview, which looks up the sheet's font on the preview
+        // thread
+        FitCache::instance()->load(FitCache::defaultFilename());
+        mainWindow.updatePreview();
+
+        // Resume printing anything left over from the last run
+        QString errorString;
+        if (!mainWindow.queueWidget()->openSpool(parser.value(spoolOption), &errorString)) {
+            qWarning("%s", qPrintable(errorString));
+        }
+
+        // Accept jobs from other programs if requested
+        if (parser.isSet(listenOption)) {
+            submissionServer.setDestination(parser.value(outputOption));
+            if (!submissionServer.listen(parser.value(listenOption), &errorString)) {
+                qWarning("%s", qPrintable(errorString));
+            }
+        }
+        trace->mark("background startup started");
+    });
+    trace->watch(&mainWindow);
 
-    MainWindow mainWindow;
     mainWindow.show();
+    trace->mark("window shown");
+
+    int ret = app.exec();
+
+    // Save the fit cache for the next run
+    FitCache::instance()->save(FitCache::defaultFilename());
 
-    return app.exec();
+    return ret;
 }
@@ -25,6 +25,8 @@
 #include <QApplication>
 #include <QBrush>
 #include <QDesktopWidget>
+#include <QFile>
+#include <QFileDialog>
 #include <QFontDialog>
 #include <QFrame>
 #include <QGraphicsPixmapItem>
@@ -32,6 +34,7 @@
 #include <QGraphicsView>
 #include <QHBoxLayout>
 #include <QIcon>
+#include <QImage>
 #include <QMessageBox>
 #include <QPageSize>
 #include <QPixmap>
@@ -40,44 +43,54 @@
 #include <QPushButton>
 #include <QRect>
 #include <QSplitter>
+#include <QTimer>
 #include <QVBoxLayout>
 
 #include "config.h"
 #include "mainwindow.h"
+#include "mergeimporter.h"
+#include "previewrenderer.h"
+#include "printerregistry.h"
 #include "printtask.h"
 #include "queuewidget.h"
 #include "sheetwidget.h"
+#include "startuptrace.h"
 
-MainWindow::MainWindow()
+// Most merged sheets waiting in the bulk lane and most records read at once
+const int MergeAhead = 64;
+
+MainWindow::MainWindow(int workerCount)
     : mSheetWidget(new SheetWidget),
-      mQueueWidget(new QueueWidget)
+      mQueueWidget(new QueueWidget(workerCount)),
+      mPreviewRenderer(new PreviewRenderer(this)),
+      mMergeImporter(nullptr)
 {
     // Create the graphics scene and view
-    QGraphicsPixmapItem *graphicsPixmapItem = new QGraphicsPixmapItem;
-    QGraphicsScene *graphicsScene= new QGraphicsScene;
-    graphicsScene->addItem(graphicsPixmapItem);
-    QGraphicsView *graphicsView = new QGraphicsView(graphicsScene);
+    mPreviewItem = new QGraphicsPixmapItem;
+    mGraphicsScene = new QGraphicsScene;
+    mGraphicsScene->addItem(mPreviewItem);
+    QGraphicsView *graphicsView = new QGraphicsView(mGraphicsScene);
     graphicsView->setBackgroundBrush(QBrush(Qt::gray));
 
-    // Draw the preview when the widget changes
-    connect(mSheetWidget, &SheetWidget::changed, [this, graphicsScene, graphicsPixmapItem]() {
-
-        // Create the rect (at 36 DPI)
-        QRect pageRect = QPageSize(QPageSize::Letter).rectPixels(36);
-
-        // Transpose dimensions for landscape
-        if (mSheetWidget->sheet().orientation == Sheet::Landscape) {
-            pageRect = pageRect.transposed();
-        }
-
-        // Create the pixmap
-        QPixmap pixmap(pageRect.width(), pageRect.height());
-        pixmap.fill();
+    // Display each preview as it finishes rendering
+    connect(mPreviewRenderer, &PreviewRenderer::rendered, [this](const QImage &image) {
+        mPreviewItem->setPixmap(QPixmap::fromImage(image));
+        mGraphicsScene->setSceneRect(image.rect());
+        StartupTrace::instance()->mark("first preview");
+    });
 
-        // Draw the contents and display it
-        mSheetWidget->sheet().draw(&pixmap, pageRect.size());
-        graphicsPixmapItem->setPixmap(pixmap);
-        graphicsScene->setSceneRect(pageRect);
+    // Redraw only the part of the preview affected by each change
+    connect(mSheetWidget, &SheetWidget::cellChanged, [this](int row, int col) {
+        updatePreview(mSheetWidget->sheet().cellRect(previewSize(), row, col));
+    });
+    connect(mSheetWidget, &SheetWidget::headerChanged, [this]() {
+        updatePreview(mSheetWidget->sheet().headerRect(previewSize()));
+    });
+    connect(mSheetWidget, &SheetWidget::footerChanged, [this]() {
+        updatePreview(mSheetWidget->sheet().footerRect(previewSize()));
+    });
+    connect(mSheetWidget, &SheetWidget::layoutChanged, [this]() {
+        updatePreview();
     });
 
     // Create the vertical line
@@ -100,6 +113,14 @@ MainWindow::MainWindow()
         }
     });
 
+    // Create the print merge button
+    QPushButton *printMergeButton = new QPushButton(tr("Print &Merge..."));
+    printMergeButton->setIcon(QIcon(":/img/print.png"));
+    connect(printMergeButton, &QPushButton::clicked, this, &MainWindow::onPrintMergeClicked);
+
+    // Queue more merged sheets as the bulk lane drains
+    connect(mQueueWidget, &QueueWidget::waitingChanged, this, &MainWindow::feedMerge, Qt::QueuedConnection);
+
     // Create the clear button
     QPushButton *clearButton = new QPushButton(tr("&Clear"));
     clearButton->setIcon(QIcon(":/img/clear.png"));
@@ -122,7 +143,7 @@ MainWindow::MainWindow()
         mSheetWidget->sheet().font = QFontDialog::getFont(
             nullptr, mSheetWidget->sheet().font
         );
-        emit mSheetWidget->changed();
+        emit mSheetWidget->layoutChanged();
     });
 
     // Create the about button
@@ -148,6 +169,7 @@ MainWindow::MainWindow()
     QVBoxLayout *vboxLayout = new QVBoxLayout;
     vboxLayout->addWidget(printButton);
     vboxLayout->addWidget(printAndClearButton);
+    vboxLayout->addWidget(printMergeButton);
     vboxLayout->addWidget(clearButton);
     vboxLayout->addWidget(hFrame);
     vboxLayout->addWidget(selectPrinterButton);
@@ -175,8 +197,19 @@ MainWindow::MainWindow()
     resize(1024, 480);
     move(QApplication::desktop()->availableGeometry().center() - rect().center());
 
-    // Redraw the preview
-    mSheetWidget->changed();
+    // The first preview is drawn once the window has been shown (so that
+    // looking up the sheet's font doesn't hold up painting it)
+    StartupTrace::instance()->mark("main window created");
+}
+
+QueueWidget *MainWindow::queueWidget() const
+{
+    return mQueueWidget;
+}
+
+void MainWindow::setDestination(const QString &destination)
+{
+    mDestination = destination;
 }
 
 bool MainWindow::onSelectPrinterClicked()
@@ -184,7 +217,16 @@ bool MainWindow::onSelectPrinterClicked()
     QPrinter printer(QPrinter::HighResolution);
     QPrintDialog printDialog(&printer);
     if (printDialog.exec() == QDialog::Accepted) {
-        mPrinterName = printer.printerName();
+
+        // The printer may be new, so find it before the first job needs it
+        PrinterRegistry::instance()->refreshAsync();
+
+        // Printing to a file is done with a PDF sink
+        if (printer.outputFormat() == QPrinter::PdfFormat && !printer.outputFileName().isEmpty()) {
+            mDestination = QString("pdf:%1").arg(printer.outputFileName());
+        } else {
+            mDestination = QString("printer:%1").arg(printer.printerName());
+        }
         return true;
     }
     return false;
@@ -192,11 +234,103 @@ bool MainWindow::onSelectPrinterClicked()
 
 bool MainWindow::onPrintClicked()
 {
-    if (!mPrinterName.isEmpty() || onSelectPrinterClicked()) {
+    if (!mDestination.isEmpty() || onSelectPrinterClicked()) {
         mQueueWidget->addTask(
-            new PrintTask(mPrinterName, mSheetWidget->sheet())
+            new PrintTask(mDestination, mSheetWidget->sheet().snapshot())
         );
         return true;
     }
     return false;
 }
+
+QSize MainWindow::previewSize() const
+{
+    // Create the rect (at 36 DPI)
+    QSize size = QPageSize(QPageSize::Letter).sizePixels(36);
+
+    // Transpose dimensions for landscape
+    if (mSheetWidget->sheet().orientation == Sheet::Landscape) {
+        size.transpose();
+    }
+
+    return size;
+}
+
+void MainWindow::updatePreview(const QRectF &dirtyRect)
+{
+    mPreviewRenderer->render(mSheetWidget->sheet().snapshot(), previewSize(), dirtyRect);
+}
+
+MainWindow::~MainWindow()
+{
+    delete mMergeImporter;
+}
+
+void MainWindow::setTracePreview(bool enabled)
+{
+    mPreviewRenderer->setTraceEnabled(enabled);
+}
+
+bool MainWindow::onPrintMergeClicked()
+{
+    if (mMergeImporter) {
+        QMessageBox::critical(this, tr("Error"), tr("A merge is already being printed."));
+        return false;
+    }
+    if (mDestination.isEmpty() && !onSelectPrinterClicked()) {
+        return false;
+    }
+
+    // Choose the file with the records
+    QString filename = QFileDialog::getOpenFileName(
+        this,
+        tr("Print Merge"),
+        QString(),
+        tr("Records (*.csv *.tsv *.txt);;All Files (*)")
+    );
+    if (filename.isEmpty()) {
+        return false;
+    }
+    mMergeFile.setFileName(filename);
+    if (!mMergeFile.open(QIODevice::ReadOnly)) {
+        QMessageBox::critical(this, tr("Error"), mMergeFile.errorString());
+        return false;
+    }
+
+    // Records are read as the queue needs them rather than all at once
+    mMergeImporter = new MergeImporter(&mMergeFile, mSheetWidget->sheet(), MergeImporter::delimiterFor(filename));
+    mMergeDestination = mDestination;
+    feedMerge();
+
+    return true;
+}
+
+void MainWindow::feedMerge()
+{
+    if (!mMergeImporter) {
+        return;
+    }
+
+    // Keep the bulk lane topped up, reading a limited number of records at
+    // a time so that the window stays responsive
+    Sheet sheet;
+    int records = 0;
+    while (mQueueWidget->waitingCount(PrintTask::Bulk) < MergeAhead) {
+        if (records == MergeAhead) {
+            QTimer::singleShot(0, this, &MainWindow::feedMerge);
+            return;
+        }
+        if (!mMergeImporter->next(&sheet)) {
+            QString errorString = mMergeImporter->errorString();
+            delete mMergeImporter;
+            mMergeImporter = nullptr;
+            mMergeFile.close();
+            if (!errorString.isEmpty()) {
+                QMessageBox::critical(this, tr("Error"), errorString);
+            }
+            return;
+        }
+        mQueueWidget->addTask(new PrintTask(mMergeDestination, sheet.snapshot()), PrintTask::Bulk);
+        ++records;
+    }
+}
@@ -25,8 +25,17 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QFile>
 #include <QMainWindow>
+#include <QRectF>
+#include <QSize>
+#include <QThread>
 
+class QGraphicsPixmapItem;
+class QGraphicsScene;
+
+class MergeImporter;
+class PreviewRenderer;
 class QueueWidget;
 class SheetWidget;
 
@@ -36,19 +45,40 @@ class MainWindow : public QMainWindow
 
 public:
 
-    MainWindow();
+    explicit MainWindow(int workerCount = QThread::idealThreadCount());
+    ~MainWindow();
+
+    QueueWidget *queueWidget() const;
+
+    void setDestination(const QString &destination);
+
+    void updatePreview(const QRectF &dirtyRect = QRectF());
+    void setTracePreview(bool enabled);
 
 private slots:
 
     bool onSelectPrinterClicked();
     bool onPrintClicked();
+    bool onPrintMergeClicked();
 
 private:
 
+    QSize previewSize() const;
+    void feedMerge();
+
     SheetWidget *mSheetWidget;
     QueueWidget *mQueueWidget;
+    PreviewRenderer *mPreviewRenderer;
+
+    QGraphicsScene *mGraphicsScene;
+    QGraphicsPixmapItem *mPreviewItem;
+
+    QString mDestination;
 
-    QString mPrinterName;
+    // Records still to be queued by the current print merge
+    QFile mMergeFile;
+    MergeImporter *mMergeImporter;
+    QString mMergeDestination;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,242 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QFileInfo>
+#include <QList>
+
+#include "mergeimporter.h"
+
+MergeImporter::MergeImporter(QIODevice *device, const Sheet &templateSheet, QChar delimiter)
+    : mStream(device),
+      mDelimiter(delimiter),
+      mTemplate(templateSheet),
+      mGroupSize(1),
+      mHasLookahead(false),
+      mRecordCount(0),
+      mSheetCount(0)
+{
+    mStream.setCodec("UTF-8");
+}
+
+QChar MergeImporter::delimiterFor(const QString &filename)
+{
+    QString suffix = QFileInfo(filename).suffix().toLower();
+    return suffix == "tsv" || suffix == "tab" ? QChar('\t') : QChar(',');
+}
+
+void MergeImporter::setGroupSize(int groupSize)
+{
+    mGroupSize = groupSize;
+}
+
+void MergeImporter::setGroupColumn(const QString &column)
+{
+    mGroupColumn = column;
+}
+
+bool MergeImporter::next(Sheet *sheet)
+{
+    if (mColumns.isEmpty()) {
+        mTimer.start();
+        if (!readColumns()) {
+            return false;
+        }
+    }
+
+    // Determine how many records go on each sheet
+    bool grouped = mGroupSize > 1 || !mGroupColumn.isEmpty();
+    int capacity = grouped ? mTemplate.rows() * mTemplate.cols() : 1;
+    if (mGroupSize > 1) {
+        capacity = qMin(capacity, mGroupSize);
+    }
+    int groupIndex = mColumnIndex.value(mGroupColumn, -1);
+    if (!mGroupColumn.isEmpty() && groupIndex < 0) {
+        mErrorString = QString("unknown column \"%1\"").arg(mGroupColumn);
+        return false;
+    }
+
+    // Collect the records for this sheet
+    QList<QStringList> records;
+    while (records.count() < qMax(capacity, 1)) {
+        QStringList record;
+        if (mHasLookahead) {
+            record = mLookahead;
+            mHasLookahead = false;
+        } else if (!readRecord(&record)) {
+            break;
+        }
+
+        // A new value in the group column starts a new sheet
+        if (groupIndex >= 0 && !records.isEmpty() &&
+                record.value(groupIndex) != records.first().value(groupIndex)) {
+            mLookahead = record;
+            mHasLookahead = true;
+            break;
+        }
+
+        records.append(record);
+        ++mRecordCount;
+    }
+    if (records.isEmpty()) {
+        return false;
+    }
+
+    // Fill in the template
+    *sheet = mTemplate;
+    sheet->headerText = substitute(mTemplate.headerText, records.first());
+    sheet->footerText = substitute(mTemplate.footerText, records.first());
+    const QVector<Cell> &cells = mTemplate.cells();
+    for (int i = 0; i < mTemplate.rows(); ++i) {
+        for (int j = 0; j < mTemplate.cols(); ++j) {
+            int index = i * mTemplate.cols() + j;
+            QString text = cells.at(index).text();
+            if (grouped) {
+                sheet->cell(i, j).setText(
+                    index < records.count() ? substitute(text, records.at(index)) : QString()
+                );
+            } else {
+                sheet->cell(i, j).setText(substitute(text, records.first()));
+            }
+        }
+    }
+
+    ++mSheetCount;
+    return true;
+}
+
+QString MergeImporter::errorString() const
+{
+    return mErrorString;
+}
+
+qint64 MergeImporter::recordCount() const
+{
+    return mRecordCount;
+}
+
+qint64 MergeImporter::sheetCount() const
+{
+    return mSheetCount;
+}
+
+double MergeImporter::recordsPerSecond() const
+{
+    qint64 elapsed = mTimer.isValid() ? mTimer.nsecsElapsed() : 0;
+    return elapsed ? mRecordCount * 1e9 / elapsed : 0;
+}
+
+bool MergeImporter::readColumns()
+{
+    if (!readRecord(&mColumns) || mColumns.isEmpty()) {
+        mErrorString = "missing column names";
+        mColumns.clear();
+        return false;
+    }
+    for (int i = 0; i < mColumns.count(); ++i) {
+        mColumnIndex.insert(mColumns.at(i).trimmed(), i);
+    }
+    return true;
+}
+
+bool MergeImporter::readRecord(QStringList *record)
+{
+    // Skip blank lines
+    QString line;
+    do {
+        if (mStream.atEnd()) {
+            return false;
+        }
+        line = mStream.readLine();
+    } while (line.isEmpty());
+
+    record->clear();
+    QString field;
+    bool quoted = false;
+    int i = 0;
+    forever {
+
+        // Quoted fields may continue onto the next line
+        if (i >= line.length()) {
+            if (quoted && !mStream.atEnd()) {
+                field.append('\n');
+                line = mStream.readLine();
+                i = 0;
+                continue;
+            }
+            break;
+        }
+
+        QChar c = line.at(i++);
+        if (quoted) {
+            if (c == '"') {
+                if (i < line.length() && line.at(i) == '"') {
+                    field.append('"');
+                    ++i;
+                } else {
+                    quoted = false;
+                }
+            } else {
+                field.append(c);
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == mDelimiter) {
+            record->append(field);
+            field.clear();
+        } else {
+            field.append(c);
+        }
+    }
+    record->append(field);
+
+    return true;
+}
+
+QString MergeImporter::substitute(const QString &text, const QStringList &record) const
+{
+    if (!text.contains('{')) {
+        return text;
+    }
+
+    // Replace each known "{column}" with its value, leaving anything else
+    QString result;
+    int pos = 0;
+    forever {
+        int start = text.indexOf('{', pos);
+        int end = start < 0 ? -1 : text.indexOf('}', start + 1);
+        if (end < 0) {
+            result.append(text.midRef(pos));
+            break;
+        }
+        int index = mColumnIndex.value(text.mid(start + 1, end - start - 1), -1);
+        if (index < 0) {
+            result.append(text.midRef(pos, end + 1 - pos));
+        } else {
+            result.append(text.midRef(pos, start - pos));
+            result.append(record.value(index));
+        }
+        pos = end + 1;
+    }
+    return result;
+}
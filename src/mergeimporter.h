@@ -0,0 +1,94 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef MERGEIMPORTER_H
+#define MERGEIMPORTER_H
+
+#include <QChar>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QIODevice>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+#include "sheet.h"
+
+/**
+ * @brief Generate sheets from CSV / TSV records one at a time
+ *
+ * The first record names the columns. Each sheet is a copy of the template
+ * with "{column}" placeholders replaced by values from the record. When
+ * records are grouped, the header and footer use the first record of the
+ * group and each cell (in row-major order) uses the next record.
+ *
+ * Only the current group of records is ever held in memory.
+ */
+class MergeImporter
+{
+public:
+
+    MergeImporter(QIODevice *device, const Sheet &templateSheet, QChar delimiter = ',');
+
+    static QChar delimiterFor(const QString &filename);
+
+    void setGroupSize(int groupSize);
+    void setGroupColumn(const QString &column);
+
+    bool next(Sheet *sheet);
+
+    QString errorString() const;
+
+    qint64 recordCount() const;
+    qint64 sheetCount() const;
+    double recordsPerSecond() const;
+
+private:
+
+    bool readColumns();
+    bool readRecord(QStringList *record);
+    QString substitute(const QString &text, const QStringList &record) const;
+
+    QTextStream mStream;
+    QChar mDelimiter;
+    Sheet mTemplate;
+
+    int mGroupSize;
+    QString mGroupColumn;
+
+    QStringList mColumns;
+    QHash<QString, int> mColumnIndex;
+
+    // Record read past the end of the previous group
+    QStringList mLookahead;
+    bool mHasLookahead;
+
+    QString mErrorString;
+
+    QElapsedTimer mTimer;
+    qint64 mRecordCount;
+    qint64 mSheetCount;
+};
+
+#endif // MERGEIMPORTER_H
@@ -0,0 +1,152 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "imagesink.h"
+#include "nullsink.h"
+#include "outputsink.h"
+#include "printerregistry.h"
+#include "printersink.h"
+#include "sheet.h"
+
+OutputSink::OutputSink(const QString &name)
+    : mPageCount(0),
+      mName(name)
+{
+}
+
+OutputSink::~OutputSink()
+{
+}
+
+OutputSink *OutputSink::create(const QString &destination, QString *errorString)
+{
+    QString type = destination.section(':', 0, 0);
+    QString target = destination.section(':', 1);
+
+    QString error;
+    if (type == "printer" || type == "raster") {
+        PrinterRegistry::Printer printer;
+        if (PrinterRegistry::instance()->find(target, &printer)) {
+            return new PrinterSink(printer, type == "raster");
+        }
+        error = QString("printer not found: %1").arg(target);
+    } else if (type == "pdf" && !target.isEmpty()) {
+        return new PrinterSink(target);
+    } else if (type == "png" && !target.isEmpty()) {
+        return new ImageSink(target);
+    } else if (type == "null") {
+        return new NullSink;
+    } else {
+        error = QString("invalid destination: %1").arg(destination);
+    }
+
+    if (errorString) {
+        *errorString = error;
+    }
+    return nullptr;
+}
+
+bool OutputSink::isValidDestination(const QString &destination)
+{
+    QString type = destination.section(':', 0, 0);
+    QString target = destination.section(':', 1);
+
+    // Whether a printer exists can only be known when the sink is created
+    if (type == "printer" || type == "raster" || type == "pdf" || type == "png") {
+        return !target.isEmpty();
+    }
+    return type == "null";
+}
+
+bool OutputSink::write(const Sheet &sheet)
+{
+    // Compile the sheet once for all of its copies, reusing anything that
+    // hasn't changed since the previous sheet
+    QSize size = pageSize(sheet.orientation);
+    mDisplayList = DisplayList::compile(sheet, size, &mDisplayList);
+
+    for (int copy = 0; copy < sheet.copies; ++copy) {
+        if (!drawPage(mDisplayList)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool OutputSink::open()
+{
+    return true;
+}
+
+bool OutputSink::setCopyCount(int)
+{
+    return false;
+}
+
+bool OutputSink::isRaster() const
+{
+    return false;
+}
+
+QImage OutputSink::render(const DisplayList &)
+{
+    return QImage();
+}
+
+bool OutputSink::drawImage(const QImage &)
+{
+    setErrorString("images cannot be printed to this destination");
+    return false;
+}
+
+bool OutputSink::close()
+{
+    return true;
+}
+
+bool OutputSink::finish()
+{
+    return close();
+}
+
+QString OutputSink::name() const
+{
+    return mName;
+}
+
+int OutputSink::pageCount() const
+{
+    return mPageCount;
+}
+
+QString OutputSink::errorString() const
+{
+    return mErrorString;
+}
+
+void OutputSink::setErrorString(const QString &errorString)
+{
+    mErrorString = errorString;
+}
@@ -0,0 +1,89 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+#include "displaylist.h"
+
+class Sheet;
+
+/**
+ * @brief Destination for rendered pages
+ *
+ * Every sink shares the same render path: each sheet is compiled into a
+ * display list at the sink's page size and the list is handed to the sink
+ * once for each copy. Sinks that print images can also render a page ahead
+ * of time so that only sending it remains. Sinks are created from destination strings of the
+ * form "printer:NAME", "raster:NAME", "pdf:FILE", "png:DIRECTORY" or "null".
+ *
+ * A sink may be kept for many jobs: each job is sent between open() and
+ * close() and the output as a whole ends with finish(). While one thread
+ * sends a job, others may call pageSize() and render() for later ones.
+ */
+class OutputSink
+{
+public:
+
+    virtual ~OutputSink();
+
+    static OutputSink *create(const QString &destination, QString *errorString = nullptr);
+    static bool isValidDestination(const QString &destination);
+
+    bool write(const Sheet &sheet);
+
+    virtual QSize pageSize(int orientation) = 0;
+    virtual bool open();
+    virtual bool setCopyCount(int copies);
+    virtual bool isRaster() const;
+    virtual QImage render(const DisplayList &displayList);
+    virtual bool drawPage(const DisplayList &displayList) = 0;
+    virtual bool drawImage(const QImage &image);
+    virtual bool close();
+    virtual bool finish();
+
+    QString name() const;
+    int pageCount() const;
+    QString errorString() const;
+
+protected:
+
+    explicit OutputSink(const QString &name);
+
+    void setErrorString(const QString &errorString);
+
+    int mPageCount;
+
+private:
+
+    QString mName;
+    DisplayList mDisplayList;
+    QString mErrorString;
+};
+
+#endif // OUTPUTSINK_H
@@ -0,0 +1,145 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QLoggingCategory>
+#include <QMutexLocker>
+
+#include "previewrenderer.h"
+
+Q_LOGGING_CATEGORY(lcPreview, "boxlabeler.preview", QtInfoMsg)
+
+PreviewRenderer::PreviewRenderer(QObject *parent)
+    : QObject(parent),
+      mWorker(new QObject),
+      mLastLatency(0),
+      mTraceEnabled(false),
+      mScheduled(false),
+      mPending(false),
+      mFullRedraw(false),
+      mRequestTime(0)
+{
+    mClock.start();
+
+    // Swap in finished images and measure how long the user waited
+    connect(this, &PreviewRenderer::imageReady, this, [this](const QImage &image, qint64 requestTime) {
+        emit rendered(image);
+        mLastLatency = mClock.nsecsElapsed() - requestTime;
+        if (mTraceEnabled) {
+            qCInfo(lcPreview) << "input-to-preview latency:" << mLastLatency / 1000 << "us";
+        }
+    }, Qt::QueuedConnection);
+
+    // Start the thread
+    mWorker->moveToThread(&mThread);
+    mThread.start();
+}
+
+PreviewRenderer::~PreviewRenderer()
+{
+    mThread.quit();
+    mThread.wait();
+    delete mWorker;
+}
+
+void PreviewRenderer::render(const SheetSnapshot &sheet, const QSize &size, const QRectF &dirtyRect)
+{
+    QMutexLocker locker(&mMutex);
+
+    // Merge with any request that has not been picked up yet
+    if (mPending) {
+        mFullRedraw = mFullRedraw || dirtyRect.isNull();
+        mDirtyRect |= dirtyRect;
+    } else {
+        mPending = true;
+        mFullRedraw = dirtyRect.isNull();
+        mDirtyRect = dirtyRect;
+        mRequestTime = mClock.nsecsElapsed();
+    }
+    mSheet = sheet;
+    mSize = size;
+
+    // Wake up the worker if it is not already busy
+    if (!mScheduled) {
+        mScheduled = true;
+        QMetaObject::invokeMethod(mWorker, [this]() { process(); }, Qt::QueuedConnection);
+    }
+}
+
+qint64 PreviewRenderer::lastLatency() const
+{
+    return mLastLatency;
+}
+
+void PreviewRenderer::setTraceEnabled(bool enabled)
+{
+    mTraceEnabled = enabled;
+}
+
+void PreviewRenderer::process()
+{
+    forever {
+
+        // Take the newest request
+        mMutex.lock();
+        if (!mPending) {
+            mScheduled = false;
+            mMutex.unlock();
+            return;
+        }
+        SheetSnapshot sheet = mSheet;
+        QSize size = mSize;
+        QRectF dirtyRect = mDirtyRect;
+        bool fullRedraw = mFullRedraw || mImage.size() != size;
+        qint64 requestTime = mRequestTime;
+        mPending = false;
+        mMutex.unlock();
+
+        // Only a change of size requires a new image - everything else is
+        // painted over the existing one
+        if (fullRedraw) {
+            if (mImage.size() != size) {
+                mImage = QImage(size, QImage::Format_ARGB32_Premultiplied);
+            }
+            mImage.fill(Qt::white);
+            sheet->draw(&mImage, size);
+        } else {
+
+            // Grow the rect slightly to catch antialiasing and glyph overhang
+            sheet->draw(&mImage, size, dirtyRect.adjusted(-2, -2, 2, 2));
+        }
+
+        // Drop the image if a newer request arrived in the meantime; the
+        // areas it painted stay valid for the next pass and the user has
+        // been waiting since this request was made
+        mMutex.lock();
+        bool stale = mPending;
+        if (stale) {
+            mRequestTime = requestTime;
+        }
+        mMutex.unlock();
+        if (!stale) {
+            emit imageReady(mImage, requestTime);
+        }
+    }
+}
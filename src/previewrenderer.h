@@ -0,0 +1,92 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PREVIEWRENDERER_H
+#define PREVIEWRENDERER_H
+
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QRectF>
+#include <QSize>
+#include <QThread>
+
+#include "sheet.h"
+
+/**
+ * @brief Render sheet previews on a background thread
+ *
+ * Requests made while a render is in progress are coalesced so that only the
+ * newest state of the sheet is rendered. A render that becomes stale before
+ * it completes is never delivered.
+ */
+class PreviewRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit PreviewRenderer(QObject *parent = nullptr);
+    ~PreviewRenderer();
+
+    void render(const SheetSnapshot &sheet, const QSize &size, const QRectF &dirtyRect = QRectF());
+
+    qint64 lastLatency() const;
+
+    void setTraceEnabled(bool enabled);
+
+signals:
+
+    void rendered(const QImage &image);
+
+    // Used internally to hand images back to the GUI thread
+    void imageReady(const QImage &image, qint64 requestTime);
+
+private:
+
+    void process();
+
+    QThread mThread;
+    QObject *mWorker;
+
+    QElapsedTimer mClock;
+    qint64 mLastLatency;
+    bool mTraceEnabled;
+
+    // Pending request, shared with the worker
+    QMutex mMutex;
+    bool mScheduled;
+    bool mPending;
+    SheetSnapshot mSheet;
+    QSize mSize;
+    QRectF mDirtyRect;
+    bool mFullRedraw;
+    qint64 mRequestTime;
+
+    // Only accessed by the worker
+    QImage mImage;
+};
+
+#endif // PREVIEWRENDERER_H
@@ -0,0 +1,157 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include "printerregistry.h"
+#include "startuptrace.h"
+
+/**
+ * @brief Runnable that refreshes the registry on the thread pool
+ */
+class RefreshRunnable : public QRunnable
+{
+public:
+
+    explicit RefreshRunnable(PrinterRegistry *registry)
+        : mRegistry(registry)
+    {
+    }
+
+    virtual void run()
+    {
+        mRegistry->refresh();
+    }
+
+private:
+
+    PrinterRegistry *mRegistry;
+};
+
+PrinterRegistry::PrinterRegistry()
+    : mLoaded(false),
+      mRefreshing(false),
+      mRefreshTime(0)
+{
+}
+
+PrinterRegistry *PrinterRegistry::instance()
+{
+    static PrinterRegistry registry;
+    return &registry;
+}
+
+bool PrinterRegistry::find(const QString &name, Printer *printer)
+{
+    {
+        QMutexLocker locker(&mMutex);
+        if (mMissing.contains(name)) {
+            return false;
+        }
+    }
+    if (lookup(name, printer)) {
+        return true;
+    }
+
+    // The printer may have been added since the list was last refreshed, but
+    // there is no point looking again until the next refresh
+    refresh();
+    if (lookup(name, printer)) {
+        return true;
+    }
+    QMutexLocker locker(&mMutex);
+    mMissing.insert(name);
+    return false;
+}
+
+void PrinterRegistry::refresh()
+{
+    {
+        QMutexLocker locker(&mMutex);
+
+        // Share the result of a refresh that has already started
+        if (mRefreshing) {
+            while (mRefreshing) {
+                mRefreshed.wait(&mMutex);
+            }
+            return;
+        }
+        mRefreshing = true;
+    }
+
+    // Enumerate without holding the lock so that lookups of printers that
+    // are already known don't have to wait
+    QElapsedTimer timer;
+    timer.start();
+    QHash<QString, Printer> printers;
+    foreach (const QPrinterInfo &info, QPrinterInfo::availablePrinters()) {
+        Printer printer;
+        printer.info = info;
+        printer.pageSizes = info.supportedPageSizes();
+        printer.defaultPageSize = info.defaultPageSize();
+        printer.resolutions = info.supportedResolutions();
+        printers.insert(info.printerName(), printer);
+    }
+    qint64 refreshTime = timer.nsecsElapsed();
+    StartupTrace::instance()->mark("printers found");
+
+    QMutexLocker locker(&mMutex);
+    mPrinters = printers;
+    mMissing.clear();
+    mLoaded = true;
+    mRefreshing = false;
+    mRefreshTime = refreshTime;
+    mRefreshed.wakeAll();
+}
+
+void PrinterRegistry::refreshAsync()
+{
+    QThreadPool::globalInstance()->start(new RefreshRunnable(this));
+}
+
+qint64 PrinterRegistry::refreshTime() const
+{
+    QMutexLocker locker(&mMutex);
+    return mRefreshTime;
+}
+
+bool PrinterRegistry::lookup(const QString &name, Printer *printer)
+{
+    QMutexLocker locker(&mMutex);
+
+    // Wait for the first list rather than building another one
+    while (!mLoaded && mRefreshing) {
+        mRefreshed.wait(&mMutex);
+    }
+
+    auto i = mPrinters.constFind(name);
+    if (i == mPrinters.constEnd()) {
+        return false;
+    }
+    *printer = i.value();
+    return true;
+}
@@ -0,0 +1,85 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PRINTERREGISTRY_H
+#define PRINTERREGISTRY_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QPageSize>
+#include <QPrinterInfo>
+#include <QSet>
+#include <QString>
+#include <QWaitCondition>
+
+/**
+ * @brief Cached list of the printers on the system
+ *
+ * Enumerating printers can take hundreds of milliseconds (especially with
+ * CUPS), so the list is built once, along with the page sizes and
+ * resolutions each printer supports, and refreshed in the background.
+ * Lookups wait for a refresh that is in progress. A name that is not found
+ * causes one refresh, in case the printer has just been added, and is then
+ * remembered as missing until the next refresh. The registry is safe to use
+ * from multiple threads.
+ */
+class PrinterRegistry
+{
+public:
+
+    struct Printer
+    {
+        QPrinterInfo info;
+        QList<QPageSize> pageSizes;
+        QPageSize defaultPageSize;
+        QList<int> resolutions;
+    };
+
+    PrinterRegistry();
+
+    static PrinterRegistry *instance();
+
+    bool find(const QString &name, Printer *printer);
+
+    void refresh();
+    void refreshAsync();
+
+    qint64 refreshTime() const;
+
+private:
+
+    bool lookup(const QString &name, Printer *printer);
+
+    mutable QMutex mMutex;
+    QWaitCondition mRefreshed;
+
+    QHash<QString, Printer> mPrinters;
+    QSet<QString> mMissing;
+    bool mLoaded;
+    bool mRefreshing;
+    qint64 mRefreshTime;
+};
+
+#endif // PRINTERREGISTRY_H
@@ -0,0 +1,301 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QImage>
+#include <QObject>
+#include <QPageLayout>
+#include <QPageSize>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+
+#include "printersink.h"
+#include "sheet.h"
+
+// Bands shorter than this aren't worth a thread of their own
+const int MinBandHeight = 128;
+
+const qreal MetersPerInch = 0.0254;
+
+// Highest resolution pages are rendered at, and the one used for printers
+// that don't list theirs
+const int MaxRasterResolution = 600;
+const int DefaultRasterResolution = 300;
+
+// Orientation of a page with the given size
+static int orientationOf(const QSize &size)
+{
+    return size.width() > size.height() ? Sheet::Landscape : Sheet::Portrait;
+}
+
+/**
+ * @brief Runnable that draws one band of a page into an image
+ */
+class BandRenderer : public QRunnable
+{
+public:
+
+    BandRenderer(const DisplayList &displayList, QImage *band,
+                 const QRect &viewport, QSemaphore *finished)
+        : mDisplayList(displayList),
+          mBand(band),
+          mViewport(viewport),
+          mFinished(finished)
+    {
+    }
+
+    virtual void run()
+    {
+        {
+            QPainter painter(mBand);
+            mDisplayList.draw(painter, mViewport);
+        }
+        mFinished->release();
+    }
+
+private:
+
+    const DisplayList &mDisplayList;
+    QImage *mBand;
+    QRect mViewport;
+    QSemaphore *mFinished;
+};
+
+PrinterSink::PrinterSink(const PrinterRegistry::Printer &printer, bool raster)
+    : OutputSink(QString("%1:%2").arg(raster ? "raster" : "printer").arg(printer.info.printerName())),
+      mPrinter(QPrinter::HighResolution),
+      mRaster(raster),
+      mPdf(false)
+{
+    // Use what the registry already knows about the printer rather than
+    // asking it again
+    mPrinter.setPrinterName(printer.info.printerName());
+
+    // Render at the printer's own resolution rather than the high
+    // resolution Qt reports, which can make a page hundreds of megabytes
+    if (raster) {
+        int resolution = 0;
+        foreach (int supported, printer.resolutions) {
+            if (supported <= MaxRasterResolution) {
+                resolution = qMax(resolution, supported);
+            }
+        }
+        mPrinter.setResolution(resolution ? resolution : DefaultRasterResolution);
+    }
+
+    // Print on Letter unless the printer can't, in which case its own
+    // default is the best guess
+    QPageSize pageSize(QPageSize::Letter);
+    if (!printer.pageSizes.isEmpty() && printer.defaultPageSize.isValid()) {
+        bool supported = false;
+        foreach (const QPageSize &size, printer.pageSizes) {
+            supported = supported || size.isEquivalentTo(pageSize);
+        }
+        if (!supported) {
+            pageSize = printer.defaultPageSize;
+        }
+    }
+    init(pageSize);
+}
+
+PrinterSink::PrinterSink(const QString &pdfFilename)
+    : OutputSink(QString("pdf:%1").arg(pdfFilename)),
+      mPrinter(QPrinter::HighResolution),
+      mRaster(false),
+      mPdf(true)
+{
+    // Embed (subsets of) the fonts so the PDF matches what was printed
+    mPrinter.setOutputFormat(QPrinter::PdfFormat);
+    mPrinter.setOutputFileName(pdfFilename);
+    mPrinter.setFontEmbeddingEnabled(true);
+    init(QPageSize(QPageSize::Letter));
+}
+
+PrinterSink::~PrinterSink()
+{
+    finish();
+}
+
+QSize PrinterSink::pageSize(int orientation)
+{
+    return mPageSizes[orientation];
+}
+
+bool PrinterSink::open()
+{
+    // The document is started with the first page, once its orientation is
+    // known
+    return true;
+}
+
+bool PrinterSink::setCopyCount(int copies)
+{
+    // Copies in a PDF would have to be separate pages
+    if (mPdf || mPainter.isActive()) {
+        return false;
+    }
+    mPrinter.setCopyCount(copies);
+    return true;
+}
+
+bool PrinterSink::isRaster() const
+{
+    return mRaster;
+}
+
+bool PrinterSink::drawPage(const DisplayList &displayList)
+{
+    if (mRaster) {
+        return drawImage(render(displayList));
+    }
+    if (!beginPage(orientationOf(displayList.size()))) {
+        return false;
+    }
+
+    displayList.draw(mPainter);
+    ++mPageCount;
+
+    return true;
+}
+
+bool PrinterSink::drawImage(const QImage &image)
+{
+    if (!beginPage(orientationOf(image.size()))) {
+        return false;
+    }
+
+    mPainter.drawImage(0, 0, image);
+    ++mPageCount;
+
+    return true;
+}
+
+bool PrinterSink::close()
+{
+    // Later jobs are added to the same PDF
+    if (mPdf) {
+        return true;
+    }
+    return finish();
+}
+
+bool PrinterSink::finish()
+{
+    if (mPainter.isActive() && !mPainter.end()) {
+        setErrorString("unable to finish printing");
+        return false;
+    }
+    return true;
+}
+
+void PrinterSink::init(const QPageSize &pageSize)
+{
+    mPrinter.setDocName(QObject::tr("Box Labeler"));
+    mPrinter.setPageSize(pageSize);
+
+    // Find the page sizes up front so that nothing needs to be asked of the
+    // printer while it is printing
+    for (int orientation : { Sheet::Portrait, Sheet::Landscape }) {
+        mPrinter.setPageOrientation(
+            orientation == Sheet::Landscape ? QPageLayout::Landscape : QPageLayout::Portrait
+        );
+        mPageSizes[orientation] = mPrinter.pageRect(QPrinter::Point).size().toSize();
+        mPagePixels[orientation] = QSize(mPrinter.width(), mPrinter.height());
+    }
+    mResolution = mPrinter.resolution();
+}
+
+bool PrinterSink::beginPage(int orientation)
+{
+    // The orientation must be set before the page is started
+    QPageLayout::Orientation pageOrientation =
+            orientation == Sheet::Landscape ? QPageLayout::Landscape : QPageLayout::Portrait;
+
+    // Beginning the painter starts the document with its first page
+    if (!mPainter.isActive()) {
+        mPrinter.setPageOrientation(pageOrientation);
+        if (!mPainter.begin(&mPrinter)) {
+            setErrorString("unable to start printing");
+            return false;
+        }
+        return true;
+    }
+
+    mPrinter.setPageOrientation(pageOrientation);
+    if (!mPrinter.newPage()) {
+        setErrorString("unable to start a new page");
+        return false;
+    }
+
+    return true;
+}
+
+QImage PrinterSink::render(const DisplayList &displayList)
+{
+    if (!mRaster) {
+        return QImage();
+    }
+
+    QSize pixels = mPagePixels[orientationOf(displayList.size())];
+    int width = pixels.width();
+    int height = pixels.height();
+    int resolution = mResolution;
+
+    // The page shares the printer's resolution so that fonts are scaled the
+    // same as when drawing to the printer directly; it is drawn in grey so
+    // edges are smooth and then held in one bit per pixel until it is sent
+    QImage page(width, height, QImage::Format_Grayscale8);
+    page.setDotsPerMeterX(qRound(resolution / MetersPerInch));
+    page.setDotsPerMeterY(qRound(resolution / MetersPerInch));
+    page.fill(Qt::white);
+
+    // Split the page into one band per core; each band is an image over
+    // the page's own rows, so nothing needs to be copied afterwards
+    int bandCount = qBound(1, height / MinBandHeight, QThread::idealThreadCount());
+    int bandHeight = (height + bandCount - 1) / bandCount;
+    QVector<QImage> bands;
+    for (int top = 0; top < height; top += bandHeight) {
+        QImage band(page.scanLine(top), width, qMin(bandHeight, height - top),
+                    page.bytesPerLine(), page.format());
+        band.setDotsPerMeterX(page.dotsPerMeterX());
+        band.setDotsPerMeterY(page.dotsPerMeterY());
+        bands.append(band);
+    }
+
+    // Every band draws the whole page offset by a whole number of pixels,
+    // clipped to the band, so the edges of neighbouring bands line up
+    // exactly; all but the first band are drawn on the pool
+    QSemaphore finished;
+    for (int i = 1; i < bands.count(); ++i) {
+        QThreadPool::globalInstance()->start(new BandRenderer(
+            displayList, &bands[i], QRect(0, -i * bandHeight, width, height), &finished
+        ));
+    }
+    BandRenderer(displayList, &bands[0], QRect(0, 0, width, height), &finished).run();
+    finished.acquire(bands.count());
+
+    return page.convertToFormat(QImage::Format_Mono, Qt::ThresholdDither);
+}
@@ -0,0 +1,80 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PRINTERSINK_H
+#define PRINTERSINK_H
+
+#include <QPainter>
+#include <QPrinter>
+
+#include "outputsink.h"
+#include "printerregistry.h"
+
+/**
+ * @brief Sink that prints pages as one document on a printer or to a PDF
+ *
+ * In raster mode, each page is rendered at the printer's resolution (up to
+ * 600 DPI) in horizontal bands, in parallel, and sent to the printer as a
+ * one bit per pixel image. This suits printers whose drivers are slow to
+ * rasterise vector pages.
+ *
+ * Each job sent to a printer is a document of its own, while every job sent
+ * to a PDF is added to the same document until the sink is finished.
+ */
+class PrinterSink : public OutputSink
+{
+public:
+
+    explicit PrinterSink(const PrinterRegistry::Printer &printer, bool raster = false);
+    explicit PrinterSink(const QString &pdfFilename);
+    ~PrinterSink();
+
+    virtual QSize pageSize(int orientation);
+    virtual bool open();
+    virtual bool setCopyCount(int copies);
+    virtual bool isRaster() const;
+    virtual QImage render(const DisplayList &displayList);
+    virtual bool drawPage(const DisplayList &displayList);
+    virtual bool drawImage(const QImage &image);
+    virtual bool close();
+    virtual bool finish();
+
+private:
+
+    void init(const QPageSize &pageSize);
+    bool beginPage(int orientation);
+
+    QPrinter mPrinter;
+    QPainter mPainter;
+    bool mRaster;
+    bool mPdf;
+
+    // Page sizes in points and in pixels for each orientation, which other
+    // threads read while a job is being printed
+    QSize mPageSizes[2];
+    QSize mPagePixels[2];
+    int mResolution;
+};
+
+#endif // PRINTERSINK_H
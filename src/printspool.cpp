@@ -0,0 +1,294 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QtEndian>
+
+#include "printspool.h"
+
+// Identifies spool files and their layout
+const quint32 SpoolMagic = 0x42535000;
+const quint32 SpoolVersion = 3;
+const qint64 FileHeaderSize = 8;
+
+// Each record starts with the size of its data, its state and (since
+// version 3) the version it was written with
+const qint64 RecordHeaderSize = 8;
+const qint64 StateOffset = 4;
+const qint64 VersionOffset = 5;
+
+enum {
+    Pending,
+    Completed
+};
+
+PrintSpool::PrintSpool()
+    : mMap(nullptr),
+      mMapSize(0),
+      mOutstanding(0)
+{
+}
+
+PrintSpool::~PrintSpool()
+{
+    close();
+}
+
+bool PrintSpool::open(const QString &filename)
+{
+    close();
+
+    QMutexLocker locker(&mMutex);
+
+    QDir().mkpath(QFileInfo(filename).absolutePath());
+
+    // Only one process may use the spool; the lock is released if that
+    // process dies
+    mLock.reset(new QLockFile(filename + ".lock"));
+    if (!mLock->tryLock()) {
+        mErrorString = mLock->error() == QLockFile::LockFailedError ?
+                    QString("%1 is in use by another instance").arg(filename) :
+                    QString("unable to lock %1").arg(filename);
+        mLock.reset();
+        return false;
+    }
+
+    mFile.setFileName(filename);
+    if (!mFile.open(QIODevice::ReadWrite)) {
+        mErrorString = mFile.errorString();
+        mLock.reset();
+        return false;
+    }
+
+    // Start a new spool or check that the existing one can be read
+    QDataStream stream(&mFile);
+    quint32 version = SpoolVersion;
+    if (mFile.size() < FileHeaderSize) {
+        mFile.resize(0);
+        stream << SpoolMagic << SpoolVersion;
+        if (!mFile.flush()) {
+            mErrorString = mFile.errorString();
+            mFile.close();
+            mLock.reset();
+            return false;
+        }
+    } else {
+        quint32 magic;
+        stream >> magic >> version;
+        if (magic != SpoolMagic || version < 1 || version > SpoolVersion) {
+            mErrorString = QString("%1 is not a spool file").arg(filename);
+            mFile.close();
+            mLock.reset();
+            return false;
+        }
+    }
+
+    // Find the jobs that have not completed, marking records written before
+    // records said which version wrote them with the version of the file
+    qint64 size = mFile.size();
+    qint64 offset = FileHeaderSize;
+    if (size > offset && !map(size)) {
+        mFile.close();
+        mLock.reset();
+        return false;
+    }
+    while (offset + RecordHeaderSize <= size) {
+        qint64 length = qFromBigEndian<quint32>(mMap + offset);
+        if (offset + RecordHeaderSize + length > size) {
+            break;
+        }
+        if (!mMap[offset + VersionOffset]) {
+            mMap[offset + VersionOffset] = static_cast<uchar>(version);
+        }
+        if (mMap[offset + StateOffset] == Pending) {
+            mPending.append(offset);
+        }
+        offset += RecordHeaderSize + length;
+    }
+
+    // Only bring the header up to date once every record is marked, so
+    // that newer records can be added to an older spool
+    if (version < SpoolVersion) {
+        mFile.seek(4);
+        stream << SpoolVersion;
+        if (!mFile.flush()) {
+            mErrorString = mFile.errorString();
+            unmap();
+            mFile.close();
+            mLock.reset();
+            return false;
+        }
+    }
+
+    mOutstanding = mPending.count();
+
+    // Drop a record that was only partly written, or everything if there is
+    // nothing left to do
+    qint64 end = mOutstanding ? offset : FileHeaderSize;
+    if (end < size) {
+        unmap();
+        mFile.resize(end);
+    }
+
+    return true;
+}
+
+void PrintSpool::close()
+{
+    QMutexLocker locker(&mMutex);
+
+    unmap();
+    mFile.close();
+    mLock.reset();
+    mPending.clear();
+    mOutstanding = 0;
+}
+
+bool PrintSpool::isOpen() const
+{
+    QMutexLocker locker(&mMutex);
+    return mFile.isOpen();
+}
+
+QList<qint64> PrintSpool::pending() const
+{
+    QMutexLocker locker(&mMutex);
+    return mPending;
+}
+
+qint64 PrintSpool::append(const QString &destination, const Sheet &sheet)
+{
+    // Serialize the job after room for the record header
+    QByteArray data(RecordHeaderSize, 0);
+    {
+        QDataStream stream(&data, QIODevice::WriteOnly | QIODevice::Append);
+        stream.setVersion(QDataStream::Qt_5_7);
+        stream << destination << sheet;
+    }
+    qToBigEndian<quint32>(data.size() - RecordHeaderSize, data.data());
+    data[static_cast<int>(StateOffset)] = static_cast<char>(Pending);
+    data[static_cast<int>(VersionOffset)] = static_cast<char>(SpoolVersion);
+
+    QMutexLocker locker(&mMutex);
+
+    qint64 offset = mFile.size();
+    if (!mFile.seek(offset) || mFile.write(data) != data.size() || !mFile.flush()) {
+        mErrorString = mFile.errorString();
+        mFile.resize(offset);
+        return -1;
+    }
+
+    ++mOutstanding;
+    return offset;
+}
+
+bool PrintSpool::read(qint64 id, QString *destination, SheetSnapshot *sheet)
+{
+    QMutexLocker locker(&mMutex);
+
+    // Map the newer part of the file if the record is not yet mapped
+    if (id + RecordHeaderSize > mMapSize && !map(mFile.size())) {
+        return false;
+    }
+    qint64 length = qFromBigEndian<quint32>(mMap + id);
+    if (id + RecordHeaderSize + length > mMapSize && !map(mFile.size())) {
+        return false;
+    }
+
+    // Read the job straight from the map
+    QByteArray data = QByteArray::fromRawData(
+        reinterpret_cast<const char*>(mMap + id + RecordHeaderSize), length
+    );
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_7);
+    Sheet *newSheet = new Sheet;
+    stream >> *destination;
+    // Cells have had types since version 2
+    if (mMap[id + VersionOffset] < 2) {
+        readUntypedSheet(stream, *newSheet);
+    } else {
+        stream >> *newSheet;
+    }
+    sheet->reset(newSheet);
+    if (stream.status() != QDataStream::Ok) {
+        mErrorString = QString("job at %1 is corrupt").arg(id);
+        return false;
+    }
+
+    return true;
+}
+
+void PrintSpool::complete(qint64 id)
+{
+    QMutexLocker locker(&mMutex);
+
+    if (id + RecordHeaderSize > mMapSize && !map(mFile.size())) {
+        return;
+    }
+    mMap[id + StateOffset] = Completed;
+
+    // Reclaim the space once nothing is left to do
+    if (!--mOutstanding) {
+        unmap();
+        mFile.resize(FileHeaderSize);
+    }
+}
+
+QString PrintSpool::errorString() const
+{
+    QMutexLocker locker(&mMutex);
+    return mErrorString;
+}
+
+QString PrintSpool::defaultFilename()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation))
+            .filePath("spool");
+}
+
+bool PrintSpool::map(qint64 end)
+{
+    unmap();
+    mMap = mFile.map(0, end);
+    if (!mMap) {
+        mErrorString = mFile.errorString();
+        return false;
+    }
+    mMapSize = end;
+    return true;
+}
+
+void PrintSpool::unmap()
+{
+    if (mMap) {
+        mFile.unmap(mMap);
+        mMap = nullptr;
+        mMapSize = 0;
+    }
+}
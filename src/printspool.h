@@ -0,0 +1,88 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PRINTSPOOL_H
+#define PRINTSPOOL_H
+
+#include <QFile>
+#include <QList>
+#include <QLockFile>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QString>
+
+#include "sheet.h"
+
+/**
+ * @brief Append-only file of queued sheets
+ *
+ * Each job is serialized to the end of the file when it is queued and read
+ * back through a memory map when a worker is ready for it, so sheets do not
+ * need to stay in memory while they wait. Completed jobs are marked in place
+ * and the file is truncated once every job in it has completed. Jobs that
+ * had not completed when the spool was last closed are available from
+ * pending() after it is opened again. The spool is safe to use from
+ * multiple threads, and a lock file keeps other processes from opening it
+ * at the same time.
+ */
+class PrintSpool
+{
+public:
+
+    PrintSpool();
+    ~PrintSpool();
+
+    bool open(const QString &filename);
+    void close();
+    bool isOpen() const;
+
+    QList<qint64> pending() const;
+
+    qint64 append(const QString &destination, const Sheet &sheet);
+    bool read(qint64 id, QString *destination, SheetSnapshot *sheet);
+    void complete(qint64 id);
+
+    QString errorString() const;
+
+    static QString defaultFilename();
+
+private:
+
+    bool map(qint64 end);
+    void unmap();
+
+    mutable QMutex mMutex;
+
+    QScopedPointer<QLockFile> mLock;
+    QFile mFile;
+    uchar *mMap;
+    qint64 mMapSize;
+
+    QList<qint64> mPending;
+    int mOutstanding;
+
+    QString mErrorString;
+};
+
+#endif // PRINTSPOOL_H
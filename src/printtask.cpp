@@ -22,37 +22,383 @@
  * IN THE SOFTWARE.
  */
 
-#include <QPageSize>
-#include <QPrinter>
-#include <QPrinterInfo>
+#include <QtGlobal>
 
+#include "outputsink.h"
+#include "printspool.h"
 #include "printtask.h"
 
-PrintTask::PrintTask(const QString &printerName, const Sheet &sheet)
-    : mPrinterName(printerName),
-      mSheet(sheet)
+PrintTask::PrintTask(const QString &destination, const SheetSnapshot &sheet)
+    : mId(0),
+      mPriority(Normal),
+      mState(Waiting),
+      mDestination(destination),
+      mSheet(sheet),
+      mOrientation(sheet->orientation),
+      mCopies(sheet->copies),
+      mFingerprint(sheet->fingerprint()),
+      mSpool(nullptr),
+      mSpoolId(-1),
+      mFailed(false)
 {
 }
 
-void PrintTask::print()
+PrintTask::PrintTask(PrintSpool *spool, qint64 id)
+    : mId(0),
+      mPriority(Normal),
+      mState(Waiting),
+      mOrientation(Sheet::Portrait),
+      mCopies(0),
+      mSpool(spool),
+      mSpoolId(id),
+      mFailed(false)
+{
+    // Read the job once for the details needed to schedule it
+    SheetSnapshot sheet;
+    if (spool->read(id, &mDestination, &sheet)) {
+        mOrientation = sheet->orientation;
+        mCopies = sheet->copies;
+        mFingerprint = sheet->fingerprint();
+    } else {
+        qWarning("%s", qPrintable(spool->errorString()));
+    }
+}
+
+PrintTask::~PrintTask()
+{
+}
+
+bool PrintTask::spool(PrintSpool *spool)
+{
+    qint64 id = spool->append(mDestination, *mSheet);
+    if (id < 0) {
+        return false;
+    }
+
+    // The sheet can be read back when it is needed
+    mSpool = spool;
+    mSpoolId = id;
+    mSheet.reset();
+    return true;
+}
+
+bool PrintTask::isSpooled() const
+{
+    return mSpool;
+}
+
+void PrintTask::discard()
+{
+    // Remove the sheets from the spool so that they aren't printed later
+    if (mSpool) {
+        mSpool->complete(mSpoolId);
+        foreach (const Request &request, mMerged) {
+            mSpool->complete(request.spoolId);
+        }
+        mSpool = nullptr;
+    }
+}
+
+qint64 PrintTask::id() const
+{
+    return mId;
+}
+
+void PrintTask::setId(qint64 id)
+{
+    mId = id;
+}
+
+QList<qint64> PrintTask::requests() const
+{
+    QList<qint64> ids;
+    ids.append(mId);
+    foreach (const Request &request, mMerged) {
+        ids.append(request.id);
+    }
+    return ids;
+}
+
+bool PrintTask::canMergeWith(const PrintTask *other) const
+{
+    // Spooled sheets can only be tracked in the same spool
+    return !mFingerprint.isEmpty() &&
+            mFingerprint == other->mFingerprint &&
+            mDestination == other->mDestination &&
+            mPriority == other->mPriority &&
+            mSpool == other->mSpool;
+}
+
+void PrintTask::merge(PrintTask *other)
+{
+    mCopies += other->mCopies;
+
+    // Keep the other task's spool record until its copies are printed
+    Request request;
+    request.id = other->mId;
+    request.spoolId = other->mSpoolId;
+    request.enqueued = other->mTiming.enqueued;
+    request.copies = other->mCopies - other->mergedCopies();
+    mMerged.append(request);
+    mMerged.append(other->mMerged);
+    other->mSpool = nullptr;
+    other->mMerged.clear();
+}
+
+bool PrintTask::cancelRequest(qint64 id)
+{
+    // The last request can only be cancelled along with the task
+    if (mMerged.isEmpty()) {
+        return false;
+    }
+
+    // Cancelling this task's own request hands its place to the first
+    // request that was merged into it
+    Request request;
+    if (id == mId) {
+        request.id = mId;
+        request.spoolId = mSpoolId;
+        request.copies = mCopies - mergedCopies();
+
+        Request first = mMerged.takeFirst();
+        mId = first.id;
+        mSpoolId = first.spoolId;
+        mTiming.enqueued = first.enqueued;
+        if (mTiming.started < mTiming.enqueued) {
+            mTiming.started = mTiming.lookedUp = mTiming.laidOut = -1;
+        }
+        if (mTiming.rendered < mTiming.enqueued) {
+            mTiming.rendered = -1;
+        }
+    } else {
+        int index = 0;
+        while (index < mMerged.count() && mMerged.at(index).id != id) {
+            ++index;
+        }
+        if (index == mMerged.count()) {
+            return false;
+        }
+        request = mMerged.takeAt(index);
+    }
+
+    // Only the cancelled request's copies and spool record are dropped
+    mCopies -= request.copies;
+    if (mSpool) {
+        mSpool->complete(request.spoolId);
+    }
+    return true;
+}
+
+PrintTask::Priority PrintTask::priority() const
+{
+    return mPriority;
+}
+
+void PrintTask::setPriority(Priority priority)
+{
+    mPriority = priority;
+}
+
+PrintTask::State PrintTask::state() const
+{
+    return mState;
+}
+
+void PrintTask::setState(State state)
+{
+    mState = state;
+}
+
+QString PrintTask::destination() const
+{
+    return mDestination;
+}
+
+void PrintTask::setSink(const QSharedPointer<OutputSink> &sink)
+{
+    mSink = sink;
+}
+
+int PrintTask::pageCount() const
+{
+    return mCopies;
+}
+
+QList<JobTiming> PrintTask::timings() const
+{
+    // Merged requests finish with this task but were queued later, so they
+    // skip any phases that had already started
+    QList<JobTiming> timings;
+    timings.append(mTiming);
+    foreach (const Request &request, mMerged) {
+        JobTiming timing = mTiming;
+        timing.enqueued = request.enqueued;
+        timing.pages = 0;
+        if (timing.started < timing.enqueued) {
+            timing.started = timing.lookedUp = timing.laidOut = -1;
+        }
+        if (timing.rendered < timing.enqueued) {
+            timing.rendered = -1;
+        }
+        timings.append(timing);
+    }
+    return timings;
+}
+
+void PrintTask::setEnqueued()
+{
+    mTiming.enqueued = QueueMetrics::now();
+}
+
+int PrintTask::mergedCopies() const
+{
+    int copies = 0;
+    foreach (const Request &request, mMerged) {
+        copies += request.copies;
+    }
+    return copies;
+}
+
+bool PrintTask::needsRendering() const
+{
+    return mSink && mSink->isRaster();
+}
+
+bool PrintTask::isRendered() const
+{
+    return !mPage.isNull();
+}
+
+bool PrintTask::hasFailed() const
 {
-    // Find the printer and initialize it
-    QPrinter printer(QPrinterInfo::printerInfo(mPrinterName), QPrinter::HighResolution);
-    printer.setDocName(tr("Box Labeler"));
-    printer.setPageSize(QPageSize(QPageSize::Letter));
+    return mFailed;
+}
+
+bool PrintTask::canSubmitWith(const PrintTask *other) const
+{
+    // Urgent tasks aren't held up by printing less urgent ones with them
+    return mSink && other->mSink &&
+            mPriority == other->mPriority &&
+            mDestination == other->mDestination &&
+            mOrientation == other->mOrientation;
+}
+
+void PrintTask::submit(const QList<PrintTask*> &tasks)
+{
+    qint64 now = QueueMetrics::now();
+    foreach (PrintTask *task, tasks) {
+        task->mTiming.submitting = now;
+    }
+
+    // Send every page to the sink of the first task as one document; a task
+    // on its own has the printer make its copies if it can
+    OutputSink *sink = tasks.first()->mSink.data();
+    bool sinkCopies = sink && tasks.count() == 1 && tasks.first()->mCopies > 1 &&
+            sink->setCopyCount(tasks.first()->mCopies);
+    if (sink && !sinkCopies) {
+        sink->setCopyCount(1);
+    }
+    bool closed = false;
+    if (sink && sink->open()) {
+        now = QueueMetrics::now();
+        foreach (PrintTask *task, tasks) {
+            task->mTiming.opened = now;
+        }
+        foreach (PrintTask *task, tasks) {
+            int copies = sinkCopies ? 1 : task->mCopies;
+            for (int copy = 0; copy < copies; ++copy) {
+                bool drawn = task->mPage.isNull() ?
+                            sink->drawPage(task->mDisplayList) :
+                            sink->drawImage(task->mPage);
+                if (drawn) {
+                    task->mTiming.pages += sinkCopies ? task->mCopies : 1;
+                } else {
+                    qWarning("%s: %s", qPrintable(task->mDestination), qPrintable(sink->errorString()));
+                }
+            }
+        }
+        closed = sink->close();
+        if (!closed) {
+            qWarning("%s: %s", qPrintable(tasks.first()->mDestination), qPrintable(sink->errorString()));
+        }
+    } else if (sink) {
+        qWarning("%s: %s", qPrintable(tasks.first()->mDestination), qPrintable(sink->errorString()));
+    }
+
+    // Signal completion of each task, removing only those whose pages were
+    // all sent from the spool so that the rest are printed when it is next
+    // opened
+    now = QueueMetrics::now();
+    foreach (PrintTask *task, tasks) {
+        task->mTiming.submitted = now;
+        task->mSink.reset();
+        task->mFailed = !closed || task->mTiming.pages < task->mCopies;
+        if (!task->mFailed) {
+            task->discard();
+        }
+        emit task->finished();
+    }
+}
+
+void PrintTask::prepare()
+{
+    mTiming.started = QueueMetrics::now();
 
-    // Set copies
-    printer.setNumCopies(mSheet.copies);
+    // Load the sheet if it was spooled
+    SheetSnapshot sheet = mSheet;
+    if (!sheet) {
+        QString destination;
+        if (!mSpool->read(mSpoolId, &destination, &sheet)) {
+            qWarning("%s", qPrintable(mSpool->errorString()));
+            mSink.reset();
+            emit prepared();
+            return;
+        }
+    }
 
-    // Adjust for landscape if necessary
-    if (mSheet.orientation == Sheet::Landscape) {
-        printer.setOrientation(QPrinter::Landscape);
+    // Create the sink for the destination unless one is shared
+    if (!mSink) {
+        QString errorString;
+        mSink.reset(OutputSink::create(mDestination, &errorString));
+        if (!mSink) {
+            qWarning("%s", qPrintable(errorString));
+            emit prepared();
+            return;
+        }
     }
+    mTiming.lookedUp = QueueMetrics::now();
 
-    // Draw the page
-    auto r = printer.pageRect(QPrinter::Point);
-    mSheet.draw(&printer, r.size().toSize());
+    // Resolve the layout and fit the text now so that only drawing remains
+    // once it is this task's turn to print
+    mDisplayList = DisplayList::compile(*sheet, mSink->pageSize(mOrientation));
+    mTiming.laidOut = QueueMetrics::now();
 
     // Signal completion
-    emit finished();
+    emit prepared();
+}
+
+void PrintTask::render()
+{
+    // Draw the page now if the sink prints images so that only sending it
+    // remains once it is this task's turn to print
+    if (needsRendering()) {
+        mPage = mSink->render(mDisplayList);
+    }
+    mTiming.rendered = QueueMetrics::now();
+}
+
+void PrintTask::submit()
+{
+    if (!mSink) {
+        prepare();
+        render();
+    }
+    submit(QList<PrintTask*>() << this);
+}
+
+void PrintTask::print()
+{
+    prepare();
+    render();
+    submit();
 }
@@ -25,12 +25,40 @@
 #ifndef PRINTTASK_H
 #define PRINTTASK_H
 
+#include <QByteArray>
+#include <QImage>
+#include <QList>
 #include <QObject>
+#include <QSharedPointer>
 
+#include "displaylist.h"
+#include "queuemetrics.h"
 #include "sheet.h"
 
+class OutputSink;
+class PrintSpool;
+
 /**
- * @brief Task for printing a sheet on a printer
+ * @brief Task for printing a sheet to a destination
+ *
+ * Printing happens in three stages: prepare() creates the output sink (unless
+ * one shared with other tasks was set) and compiles the sheet into a display
+ * list, render() draws the page ahead of
+ * time if the sink prints images, and submit() sends it to the sink. Only
+ * submit() needs to be ordered with respect to other tasks.
+ * Several prepared tasks for the same destination and orientation can be
+ * submitted together as a single document.
+ *
+ * A task that has been written to a spool only holds on to its sheet while
+ * it is being prepared, and is only removed from the spool once every page
+ * has been sent. A task that failed stays in the spool to be printed when it
+ * is next opened.
+ *
+ * The priority and state of a task are only used by the queue that
+ * schedules it. Tasks that print the same sheet can be merged, in which
+ * case one task prints the copies of all of them but keeps track of each
+ * request so that they can be accounted for (and cancelled) separately
+ * while the task is waiting.
  */
 class PrintTask : public QObject
 {
@@ -38,20 +66,105 @@ class PrintTask : public QObject
 
 public:
 
-    PrintTask(const QString &printerName, const Sheet &sheet);
+    enum Priority {
+        Urgent,
+        Normal,
+        Bulk,
+        PriorityCount
+    };
+
+    enum State {
+        Waiting,
+        Preparing,
+        Prepared,
+        Rendering,
+        Ready,
+        Printing,
+        Cancelled
+    };
+
+    PrintTask(const QString &destination, const SheetSnapshot &sheet);
+    PrintTask(PrintSpool *spool, qint64 id);
+    ~PrintTask();
+
+    bool spool(PrintSpool *spool);
+    bool isSpooled() const;
+    void discard();
+
+    qint64 id() const;
+    void setId(qint64 id);
+    QList<qint64> requests() const;
+
+    bool canMergeWith(const PrintTask *other) const;
+    void merge(PrintTask *other);
+    bool cancelRequest(qint64 id);
+
+    Priority priority() const;
+    void setPriority(Priority priority);
+
+    State state() const;
+    void setState(State state);
+
+    QString destination() const;
+    void setSink(const QSharedPointer<OutputSink> &sink);
+    int pageCount() const;
+
+    QList<JobTiming> timings() const;
+    void setEnqueued();
+
+    bool needsRendering() const;
+    bool isRendered() const;
+    bool hasFailed() const;
+
+    bool canSubmitWith(const PrintTask *other) const;
+    static void submit(const QList<PrintTask*> &tasks);
 
 signals:
 
+    void prepared();
     void finished();
 
 public slots:
 
+    void prepare();
+    void render();
+    void submit();
+
     void print();
 
 private:
 
-    QString mPrinterName;
-    Sheet mSheet;
+    struct Request
+    {
+        qint64 id;
+        qint64 spoolId;
+        qint64 enqueued;
+        int copies;
+    };
+
+    int mergedCopies() const;
+
+    qint64 mId;
+    Priority mPriority;
+    State mState;
+    QString mDestination;
+    SheetSnapshot mSheet;
+    int mOrientation;
+    int mCopies;
+    QByteArray mFingerprint;
+
+    // Tasks that were merged into this one
+    QList<Request> mMerged;
+
+    PrintSpool *mSpool;
+    qint64 mSpoolId;
+
+    QSharedPointer<OutputSink> mSink;
+    DisplayList mDisplayList;
+    QImage mPage;
+    bool mFailed;
+
+    JobTiming mTiming;
 };
 
 #endif // PRINTTASK_H
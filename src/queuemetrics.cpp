@@ -0,0 +1,351 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include "queuemetrics.h"
+
+// Percentiles that are reported
+const double Percentiles[] = { 0.5, 0.95, 0.99 };
+
+static QElapsedTimer startClock()
+{
+    QElapsedTimer clock;
+    clock.start();
+    return clock;
+}
+
+JobTiming::JobTiming()
+    : enqueued(-1),
+      started(-1),
+      lookedUp(-1),
+      laidOut(-1),
+      rendered(-1),
+      submitting(-1),
+      opened(-1),
+      submitted(-1),
+      pages(0)
+{
+}
+
+QueueMetrics::QueueMetrics(int windowSize)
+    : mWindowSize(qMax(windowSize, 1)),
+      mDirty(false),
+      mJobCount(0),
+      mPageCount(0),
+      mQueueLength(0),
+      mWorkerCount(1),
+      mActiveTime(0),
+      mPrinterRefreshTime(0)
+{
+    for (int i = 0; i < PhaseCount; ++i) {
+        mNext[i] = 0;
+        mPhaseTime[i] = 0;
+        mPhaseCount[i] = 0;
+    }
+    for (int i = 0; i < StageCount; ++i) {
+        mBusyTime[i] = 0;
+        mBuffered[i] = 0;
+    }
+}
+
+qint64 QueueMetrics::now()
+{
+    // Share one clock between threads
+    static const QElapsedTimer clock = startClock();
+    return clock.nsecsElapsed();
+}
+
+QString QueueMetrics::phaseName(int phase)
+{
+    switch (phase) {
+    case Wait:
+        return "wait";
+    case Lookup:
+        return "lookup";
+    case Layout:
+        return "layout";
+    case Render:
+        return "render";
+    case Hold:
+        return "hold";
+    case Open:
+        return "open";
+    case Print:
+        return "print";
+    default:
+        return "total";
+    }
+}
+
+QString QueueMetrics::stageName(int stage)
+{
+    switch (stage) {
+    case Prepare:
+        return "prepare";
+    case Raster:
+        return "raster";
+    default:
+        return "submit";
+    }
+}
+
+void QueueMetrics::record(const JobTiming &timing)
+{
+    // Pair the start and end of each phase; pages that aren't rendered
+    // ahead of time are ready as soon as they are laid out
+    qint64 ready = timing.rendered < 0 ? timing.laidOut : timing.rendered;
+    const qint64 bounds[PhaseCount][2] = {
+        { timing.enqueued, timing.started },
+        { timing.started, timing.lookedUp },
+        { timing.lookedUp, timing.laidOut },
+        { timing.laidOut, timing.rendered },
+        { ready, timing.submitting },
+        { timing.submitting, timing.opened },
+        { timing.opened, timing.submitted },
+        { timing.enqueued, timing.submitted }
+    };
+
+    // Replace the oldest sample once the window is full
+    for (int i = 0; i < PhaseCount; ++i) {
+        if (bounds[i][0] < 0 || bounds[i][1] < 0) {
+            continue;
+        }
+        qint64 duration = bounds[i][1] - bounds[i][0];
+        mPhaseTime[i] += duration;
+        ++mPhaseCount[i];
+        if (mSamples[i].count() < mWindowSize) {
+            mSamples[i].append(duration);
+        } else {
+            mSamples[i][mNext[i]] = duration;
+            mNext[i] = (mNext[i] + 1) % mWindowSize;
+        }
+    }
+    mDirty = true;
+
+    ++mJobCount;
+    mPageCount += timing.pages;
+}
+
+void QueueMetrics::setQueueLength(int queueLength)
+{
+    mQueueLength = queueLength;
+}
+
+void QueueMetrics::setWorkerCount(int workerCount)
+{
+    mWorkerCount = qMax(workerCount, 1);
+}
+
+void QueueMetrics::setActiveTime(qint64 activeTime)
+{
+    mActiveTime = activeTime;
+}
+
+void QueueMetrics::addBusyTime(int stage, qint64 busyTime)
+{
+    mBusyTime[stage] += busyTime;
+}
+
+void QueueMetrics::setBuffered(int stage, int buffered)
+{
+    mBuffered[stage] = buffered;
+}
+
+double QueueMetrics::utilization(int stage) const
+{
+    // Share of the workers' time while the queue was active
+    if (mActiveTime <= 0) {
+        return 0;
+    }
+    return static_cast<double>(mBusyTime[stage]) / (mActiveTime * mWorkerCount);
+}
+
+int QueueMetrics::buffered(int stage) const
+{
+    return mBuffered[stage];
+}
+
+void QueueMetrics::setPrinterRefreshTime(qint64 refreshTime)
+{
+    mPrinterRefreshTime = refreshTime;
+}
+
+quint64 QueueMetrics::jobCount() const
+{
+    return mJobCount;
+}
+
+quint64 QueueMetrics::pageCount() const
+{
+    return mPageCount;
+}
+
+int QueueMetrics::sampleCount(int phase) const
+{
+    return mSamples[phase].count();
+}
+
+qint64 QueueMetrics::percentile(int phase, double p) const
+{
+    sort();
+
+    // Use the nearest rank
+    const QVector<qint64> &sorted = mSorted[phase];
+    if (sorted.isEmpty()) {
+        return 0;
+    }
+    int rank = static_cast<int>(std::ceil(p * sorted.count()));
+    return sorted.at(qBound(0, rank - 1, sorted.count() - 1));
+}
+
+bool QueueMetrics::save(const QString &filename) const
+{
+    QDir().mkpath(QFileInfo(filename).absolutePath());
+
+    // Replace the file in one step so that readers never see part of it
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QFileInfo(filename).suffix() == "json" ? toJson() : toPrometheus());
+    return file.commit();
+}
+
+QByteArray QueueMetrics::toJson() const
+{
+    QJsonObject phases;
+    for (int i = 0; i < PhaseCount; ++i) {
+        QJsonObject phase;
+        phase.insert("samples", sampleCount(i));
+        for (double p : Percentiles) {
+            phase.insert(
+                QString("p%1").arg(qRound(p * 100)),
+                percentile(i, p) / 1000000.0
+            );
+        }
+        phases.insert(phaseName(i), phase);
+    }
+
+    QJsonObject stages;
+    for (int i = 0; i < StageCount; ++i) {
+        QJsonObject stage;
+        stage.insert("busySeconds", mBusyTime[i] / 1e9);
+        stage.insert("utilization", utilization(i));
+        stage.insert("buffered", mBuffered[i]);
+        stages.insert(stageName(i), stage);
+    }
+
+    QJsonObject object;
+    object.insert("jobs", static_cast<double>(mJobCount));
+    object.insert("pages", static_cast<double>(mPageCount));
+    object.insert("queueLength", mQueueLength);
+    object.insert("phasesMs", phases);
+    object.insert("stages", stages);
+    object.insert("printerRefreshMs", mPrinterRefreshTime / 1000000.0);
+    return QJsonDocument(object).toJson();
+}
+
+QByteArray QueueMetrics::toPrometheus() const
+{
+    QByteArray data;
+
+    data += "# HELP boxlabeler_jobs_total Print jobs completed.\n"
+            "# TYPE boxlabeler_jobs_total counter\n";
+    data += "boxlabeler_jobs_total " + QByteArray::number(mJobCount) + "\n";
+
+    data += "# HELP boxlabeler_pages_total Pages printed.\n"
+            "# TYPE boxlabeler_pages_total counter\n";
+    data += "boxlabeler_pages_total " + QByteArray::number(mPageCount) + "\n";
+
+    data += "# HELP boxlabeler_queue_length Jobs waiting or in progress.\n"
+            "# TYPE boxlabeler_queue_length gauge\n";
+    data += "boxlabeler_queue_length " + QByteArray::number(mQueueLength) + "\n";
+
+    // Quantiles are over recent jobs, but the sum and count have to keep
+    // growing for rates to be taken from them
+    data += "# HELP boxlabeler_job_phase_seconds Time jobs spent in each phase.\n"
+            "# TYPE boxlabeler_job_phase_seconds summary\n";
+    for (int i = 0; i < PhaseCount; ++i) {
+        QByteArray phase = phaseName(i).toUtf8();
+        for (double p : Percentiles) {
+            data += "boxlabeler_job_phase_seconds{phase=\"" + phase + "\",quantile=\"" +
+                    QByteArray::number(p) + "\"} " +
+                    QByteArray::number(percentile(i, p) / 1e9, 'f', 6) + "\n";
+        }
+        data += "boxlabeler_job_phase_seconds_sum{phase=\"" + phase + "\"} " +
+                QByteArray::number(mPhaseTime[i] / 1e9, 'f', 6) + "\n";
+        data += "boxlabeler_job_phase_seconds_count{phase=\"" + phase + "\"} " +
+                QByteArray::number(mPhaseCount[i]) + "\n";
+    }
+
+    data += "# HELP boxlabeler_printer_refresh_seconds Time taken to find the printers on the system.\n"
+            "# TYPE boxlabeler_printer_refresh_seconds gauge\n";
+    data += "boxlabeler_printer_refresh_seconds " +
+            QByteArray::number(mPrinterRefreshTime / 1e9, 'f', 6) + "\n";
+
+    data += "# HELP boxlabeler_stage_busy_seconds_total Worker time spent in each pipeline stage.\n"
+            "# TYPE boxlabeler_stage_busy_seconds_total counter\n";
+    for (int i = 0; i < StageCount; ++i) {
+        data += "boxlabeler_stage_busy_seconds_total{stage=\"" + stageName(i).toUtf8() + "\"} " +
+                QByteArray::number(mBusyTime[i] / 1e9, 'f', 6) + "\n";
+    }
+
+    data += "# HELP boxlabeler_stage_utilization Share of worker time spent in each pipeline stage while the queue was active.\n"
+            "# TYPE boxlabeler_stage_utilization gauge\n";
+    for (int i = 0; i < StageCount; ++i) {
+        data += "boxlabeler_stage_utilization{stage=\"" + stageName(i).toUtf8() + "\"} " +
+                QByteArray::number(utilization(i), 'f', 4) + "\n";
+    }
+
+    data += "# HELP boxlabeler_stage_buffered Jobs waiting for each pipeline stage.\n"
+            "# TYPE boxlabeler_stage_buffered gauge\n";
+    for (int i = 0; i < StageCount; ++i) {
+        data += "boxlabeler_stage_buffered{stage=\"" + stageName(i).toUtf8() + "\"} " +
+                QByteArray::number(mBuffered[i]) + "\n";
+    }
+
+    return data;
+}
+
+void QueueMetrics::sort() const
+{
+    if (!mDirty) {
+        return;
+    }
+    for (int i = 0; i < PhaseCount; ++i) {
+        mSorted[i] = mSamples[i];
+        std::sort(mSorted[i].begin(), mSorted[i].end());
+    }
+    mDirty = false;
+}
@@ -0,0 +1,144 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef QUEUEMETRICS_H
+#define QUEUEMETRICS_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief Times at which a job reached each stage of the print pipeline
+ *
+ * Times are in nanoseconds on the clock returned by QueueMetrics::now() and
+ * are -1 for stages that were never reached.
+ */
+struct JobTiming
+{
+    JobTiming();
+
+    qint64 enqueued;
+    qint64 started;
+    qint64 lookedUp;
+    qint64 laidOut;
+    qint64 rendered;
+    qint64 submitting;
+    qint64 opened;
+    qint64 submitted;
+    int pages;
+};
+
+/**
+ * @brief Rolling statistics for jobs that went through the print queue
+ *
+ * The time spent in each phase is kept for the most recent jobs so that
+ * percentiles reflect current behavior, along with totals over every job. The share of worker time spent in
+ * each stage of the pipeline and the number of tasks waiting for each stage
+ * show which one is holding the others up. Metrics can be written as JSON or
+ * in the Prometheus text format for monitoring systems to collect.
+ */
+class QueueMetrics
+{
+public:
+
+    enum Phase {
+        Wait,
+        Lookup,
+        Layout,
+        Render,
+        Hold,
+        Open,
+        Print,
+        Total,
+        PhaseCount
+    };
+
+    enum Stage {
+        Prepare,
+        Raster,
+        Submit,
+        StageCount
+    };
+
+    explicit QueueMetrics(int windowSize = 1000);
+
+    static qint64 now();
+    static QString phaseName(int phase);
+    static QString stageName(int stage);
+
+    void record(const JobTiming &timing);
+    void setQueueLength(int queueLength);
+
+    void setWorkerCount(int workerCount);
+    void setActiveTime(qint64 activeTime);
+    void addBusyTime(int stage, qint64 busyTime);
+    void setBuffered(int stage, int buffered);
+    double utilization(int stage) const;
+    int buffered(int stage) const;
+
+    void setPrinterRefreshTime(qint64 refreshTime);
+
+    quint64 jobCount() const;
+    quint64 pageCount() const;
+
+    int sampleCount(int phase) const;
+    qint64 percentile(int phase, double p) const;
+
+    bool save(const QString &filename) const;
+
+private:
+
+    QByteArray toJson() const;
+    QByteArray toPrometheus() const;
+
+    void sort() const;
+
+    int mWindowSize;
+    QVector<qint64> mSamples[PhaseCount];
+    int mNext[PhaseCount];
+
+    // Totals over every job, which unlike the samples are never trimmed
+    qint64 mPhaseTime[PhaseCount];
+    quint64 mPhaseCount[PhaseCount];
+
+    // Sorted copies of the samples, rebuilt when they are next needed
+    mutable QVector<qint64> mSorted[PhaseCount];
+    mutable bool mDirty;
+
+    quint64 mJobCount;
+    quint64 mPageCount;
+    int mQueueLength;
+
+    // Time workers spent in each stage and tasks waiting for each stage
+    int mWorkerCount;
+    qint64 mActiveTime;
+    qint64 mBusyTime[StageCount];
+    int mBuffered[StageCount];
+
+    // Time taken to find the printers on the system
+    qint64 mPrinterRefreshTime;
+};
+
+#endif // QUEUEMETRICS_H
@@ -22,29 +22,87 @@
  * IN THE SOFTWARE.
  */
 
+#include <QAction>
 #include <QFont>
 #include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMenu>
+#include <QStringList>
+#include <QTimer>
+#include <QVBoxLayout>
 
-#include "printtask.h"
+#include "printerregistry.h"
 #include "queuewidget.h"
 
-QueueWidget::QueueWidget()
-    : mStatusLabel(new QLabel),
-      mQueueLength(0)
+// Largest number of sheets combined into one document
+const int DefaultBatchSize = 50;
+
+// Time to wait for more sheets before printing a partial batch (in ms)
+const int DefaultBatchWindow = 0;
+
+// Number of full batches that may be prepared ahead of printing
+const int PrepareAhead = 2;
+
+// Number of pages that may be rendered ahead of printing
+const int RenderAhead = 8;
+
+QueueWidget::QueueWidget(int workerCount)
+    : mBatchSize(DefaultBatchSize),
+      mBatchWindow(DefaultBatchWindow),
+      mRenderedCount(0),
+      mRetryScheduled(false),
+      mBusyTime(0),
+      mBusySince(0),
+      mPagesPrinted(0),
+      mFailedCount(0),
+      mStatusLabel(new QLabel),
+      mJobList(new QTreeWidget),
+      mQueueLength(0),
+      mLastId(0)
 {
     // Initialize the label
     QLabel *label = new QLabel(tr("Status:"));
     label->setStyleSheet("font-weight: bold;");
 
+    // Initialize the list of jobs, which has an item for each lane
+    mJobList->setHeaderLabels(
+        QStringList() << tr("Job") << tr("Destination") << tr("Copies") << tr("State")
+    );
+    mJobList->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    mJobList->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(mJobList, &QTreeWidget::customContextMenuRequested, this, &QueueWidget::showJobMenu);
+    for (int i = 0; i < PrintTask::PriorityCount; ++i) {
+        mLaneItems[i] = new QTreeWidgetItem(mJobList);
+        mLaneItems[i]->setExpanded(true);
+    }
+
     // Create the layout
     QHBoxLayout *hboxLayout = new QHBoxLayout;
     hboxLayout->setMargin(0);
     hboxLayout->addWidget(label);
     hboxLayout->addWidget(mStatusLabel, 1);
-    setLayout(hboxLayout);
 
-    // Start the thread
-    mThread.start();
+    QVBoxLayout *vboxLayout = new QVBoxLayout;
+    vboxLayout->setMargin(0);
+    vboxLayout->addLayout(hboxLayout);
+    vboxLayout->addWidget(mJobList);
+    setLayout(vboxLayout);
+
+    // Start the worker threads
+    mWorkers.resize(qMax(workerCount, 1));
+    for (auto i = mWorkers.begin(); i != mWorkers.end(); ++i) {
+        i->thread = new QThread;
+        i->context = new QObject;
+        i->context->moveToThread(i->thread);
+        i->stage = QueueMetrics::Prepare;
+        i->completed = 0;
+        i->thread->start();
+    }
+
+    mClock.start();
+    mMetrics.setWorkerCount(mWorkers.count());
+
+    connect(&mMetricsTimer, &QTimer::timeout, this, &QueueWidget::saveMetrics);
 
     // Update the label
     updateLabel();
@@ -52,29 +110,731 @@ QueueWidget::QueueWidget()
 
 QueueWidget::~QueueWidget()
 {
-    mThread.quit();
-    mThread.wait();
+    foreach (const Worker &worker, mWorkers) {
+        worker.thread->quit();
+        worker.thread->wait();
+        delete worker.context;
+        delete worker.thread;
+    }
+
+    // Finish any documents that were kept open for later jobs
+    foreach (const QSharedPointer<OutputSink> &sink, mSinks) {
+        if (!sink->finish()) {
+            qWarning("%s: %s", qPrintable(sink->name()), qPrintable(sink->errorString()));
+        }
+    }
+}
+
+bool QueueWidget::openSpool(const QString &filename, QString *errorString)
+{
+    if (!mSpool.open(filename)) {
+        if (errorString) {
+            *errorString = mSpool.errorString();
+        }
+        return false;
+    }
+
+    // Resume the jobs that did not complete last time
+    foreach (qint64 id, mSpool.pending()) {
+        addTask(new PrintTask(&mSpool, id));
+    }
+
+    return true;
 }
 
-void QueueWidget::addTask(PrintTask *task)
+qint64 QueueWidget::addTask(PrintTask *task, PrintTask::Priority priority)
 {
+    task->setId(++mLastId);
+    task->setPriority(priority);
+    task->setEnqueued();
+
+    // Keep the sheet on disk until it is needed
+    if (mSpool.isOpen() && !task->isSpooled() && !task->spool(&mSpool)) {
+        qWarning("%s", qPrintable(mSpool.errorString()));
+    }
+
+    // Print the same sheet as the last task for the destination along with
+    // it, which saves laying it out and printing it as a separate document
+    auto queue = mDestinationQueues.constFind(task->destination());
+    if (queue != mDestinationQueues.constEnd()) {
+        PrintTask *last = queue->last();
+        PrintTask::State state = last->state();
+        if ((state == PrintTask::Waiting || state == PrintTask::Prepared || state == PrintTask::Ready) &&
+                last->canMergeWith(task)) {
+            qint64 id = task->id();
+            last->merge(task);
+            delete task;
+            mTasks.insert(id, last);
+            updateItem(last);
+            updateLabel();
+            return id;
+        }
+    }
+
+    // Start measuring throughput when the queue becomes busy
+    if (!mQueueLength) {
+        mBusySince = mClock.elapsed();
+    }
+
     // Update the queue length
     ++mQueueLength;
+
+    mTasks.insert(task->id(), task);
+    enqueue(task, false);
+
+    dispatch();
+
+    return task->id();
+}
+
+bool QueueWidget::cancelTask(qint64 id)
+{
+    PrintTask *task = mTasks.value(id);
+    if (!task || task->state() == PrintTask::Printing) {
+        return false;
+    }
+
+    // Cancelling one of several merged requests only takes away its copies,
+    // which can't change once a worker has started laying the task out
+    if (task->requests().count() > 1) {
+        if (task->state() != PrintTask::Waiting || !task->cancelRequest(id)) {
+            return false;
+        }
+        mTasks.remove(id);
+        updateItem(task);
+        updateLabel();
+        return true;
+    }
+
+    PrintTask::State state = task->state();
+    remove(task);
+
+    // A task being prepared or rendered is deleted once its worker is done
+    // with it
+    if (state == PrintTask::Preparing || state == PrintTask::Rendering) {
+        task->setState(PrintTask::Cancelled);
+    } else {
+        if (task->isRendered()) {
+            --mRenderedCount;
+        }
+        task->discard();
+        delete task;
+    }
+
+    // Stop measuring throughput when the queue becomes idle
+    --mQueueLength;
+    if (!mQueueLength) {
+        mBusyTime += mClock.elapsed() - mBusySince;
+    }
+
+    dispatch();
+
+    return true;
+}
+
+bool QueueWidget::moveToFront(qint64 id)
+{
+    PrintTask *task = mTasks.value(id);
+    if (!task || task->state() == PrintTask::Printing) {
+        return false;
+    }
+
+    // Take the task out of the queue and put it back at the front of the
+    // urgent lane
+    if (task->state() == PrintTask::Waiting) {
+        mWaiting[task->priority()].removeOne(task);
+    }
+    mDestinationQueues[task->destination()].removeOne(task);
+    QTreeWidgetItem *item = mJobItems.value(task);
+    item->parent()->removeChild(item);
+
+    task->setPriority(PrintTask::Urgent);
+    enqueue(task, true);
+
+    dispatch();
+
+    return true;
+}
+
+int QueueWidget::queueLength() const
+{
+    return mQueueLength;
+}
+
+int QueueWidget::waitingCount(PrintTask::Priority priority) const
+{
+    return mWaiting[priority].count();
+}
+
+int QueueWidget::position(qint64 id) const
+{
+    PrintTask *task = mTasks.value(id);
+    if (!task) {
+        return 0;
+    }
+    return mDestinationQueues.value(task->destination()).indexOf(task) + 1;
+}
+
+int QueueWidget::batchSize() const
+{
+    return mBatchSize;
+}
+
+void QueueWidget::setBatchSize(int batchSize)
+{
+    mBatchSize = qMax(batchSize, 1);
+}
+
+int QueueWidget::batchWindow() const
+{
+    return mBatchWindow;
+}
+
+void QueueWidget::setBatchWindow(int batchWindow)
+{
+    mBatchWindow = qMax(batchWindow, 0);
+}
+
+void QueueWidget::setMetricsFile(const QString &filename, int interval)
+{
+    mMetricsFilename = filename;
+    if (filename.isEmpty()) {
+        mMetricsTimer.stop();
+    } else {
+        mMetricsTimer.start(qMax(interval, 1));
+    }
+}
+
+void QueueWidget::enqueue(PrintTask *task, bool front)
+{
+    PrintTask::Priority priority = task->priority();
+    if (task->state() == PrintTask::Waiting) {
+        if (front) {
+            mWaiting[priority].prepend(task);
+        } else {
+            mWaiting[priority].append(task);
+        }
+    }
+
+    // Keep each destination's queue in order of priority, without passing
+    // the tasks that have started printing
+    QList<PrintTask*> &queue = mDestinationQueues[task->destination()];
+    int index = queue.count();
+    while (index > 0) {
+        PrintTask *previous = queue.at(index - 1);
+        if (previous->state() == PrintTask::Printing ||
+                previous->priority() < priority ||
+                (previous->priority() == priority && !front)) {
+            break;
+        }
+        --index;
+    }
+    queue.insert(index, task);
+
+    // Show the task in its lane
+    QTreeWidgetItem *item = mJobItems.value(task);
+    if (!item) {
+        item = new QTreeWidgetItem;
+        item->setText(1, task->destination());
+        mJobItems.insert(task, item);
+        updateItem(task);
+    }
+    if (front) {
+        mLaneItems[priority]->insertChild(0, item);
+    } else {
+        mLaneItems[priority]->addChild(item);
+    }
+    setState(task, task->state());
+}
+
+void QueueWidget::updateItem(PrintTask *task)
+{
+    QTreeWidgetItem *item = mJobItems.value(task);
+    int merged = task->requests().count() - 1;
+    item->setData(0, Qt::UserRole, task->id());
+    item->setText(0, merged ?
+                      tr("%1 (+%2)").arg(task->id()).arg(merged) :
+                      QString::number(task->id()));
+    item->setText(2, QString::number(task->pageCount()));
+}
+
+void QueueWidget::remove(PrintTask *task)
+{
+    foreach (qint64 id, task->requests()) {
+        mTasks.remove(id);
+    }
+    if (task->state() == PrintTask::Waiting) {
+        mWaiting[task->priority()].removeOne(task);
+    }
+    mPrepared.remove(task);
+
+    QList<PrintTask*> &queue = mDestinationQueues[task->destination()];
+    queue.removeOne(task);
+    if (queue.isEmpty()) {
+        mDestinationQueues.remove(task->destination());
+    }
+
+    delete mJobItems.take(task);
+}
+
+void QueueWidget::setState(PrintTask *task, PrintTask::State state)
+{
+    task->setState(state);
+
+    QString text;
+    switch (state) {
+    case PrintTask::Waiting:
+        text = tr("waiting");
+        break;
+    case PrintTask::Preparing:
+        text = tr("laying out");
+        break;
+    case PrintTask::Prepared:
+        text = tr("laid out");
+        break;
+    case PrintTask::Rendering:
+        text = tr("rendering");
+        break;
+    case PrintTask::Ready:
+        text = tr("ready");
+        break;
+    case PrintTask::Printing:
+        text = tr("printing");
+        break;
+    case PrintTask::Cancelled:
+        text = tr("cancelled");
+        break;
+    }
+    QTreeWidgetItem *item = mJobItems.value(task);
+    if (item) {
+        item->setText(3, text);
+    }
+}
+
+void QueueWidget::dispatch()
+{
+    for (auto i = mWorkers.begin(); i != mWorkers.end(); ++i) {
+        if (!i->tasks.isEmpty()) {
+            continue;
+        }
+
+        // Urgent tasks are prepared as soon as a worker is free
+        if (!mWaiting[PrintTask::Urgent].isEmpty()) {
+            prepare(*i, takeWaiting());
+            continue;
+        }
+
+        // Otherwise prefer the latest stage so that printers stay busy
+        QList<PrintTask*> tasks = nextSubmission();
+        PrintTask *task = nullptr;
+        if (!tasks.isEmpty()) {
+            submit(*i, tasks);
+        } else if ((task = nextRender())) {
+            render(*i, task);
+        } else if ((task = takeWaiting())) {
+            prepare(*i, task);
+        } else {
+            break;
+        }
+    }
+
     updateLabel();
+    emit waitingChanged();
+}
+
+PrintTask *QueueWidget::takeWaiting()
+{
+    // Take the first task from the most urgent lane, preparing only a
+    // limited number of tasks ahead of printing unless they are urgent
+    bool full = mPrepared.count() >= mBatchSize * PrepareAhead;
+    for (int i = 0; i < PrintTask::PriorityCount; ++i) {
+        if (!mWaiting[i].isEmpty() && (i == PrintTask::Urgent || !full)) {
+            return mWaiting[i].takeFirst();
+        }
+    }
+
+    // A task that has jumped ahead of prepared ones in its destination's
+    // queue must still be prepared, or none of them could be printed
+    for (auto i = mDestinationQueues.constBegin(); i != mDestinationQueues.constEnd(); ++i) {
+        PrintTask *first = i.value().first();
+        if (first->state() == PrintTask::Waiting) {
+            mWaiting[first->priority()].removeOne(first);
+            return first;
+        }
+    }
+
+    return nullptr;
+}
+
+PrintTask *QueueWidget::nextRender() const
+{
+    // Render pages in the order they will be printed and only a limited
+    // number at a time, unless one is holding up its destination
+    bool full = mRenderedCount >= RenderAhead;
+    for (auto i = mDestinationQueues.constBegin(); i != mDestinationQueues.constEnd(); ++i) {
+        bool first = true;
+        foreach (PrintTask *task, i.value()) {
+            PrintTask::State state = task->state();
+            if (state == PrintTask::Printing) {
+                continue;
+            }
+            if (state == PrintTask::Prepared && (first || !full)) {
+                return task;
+            }
+            if (state == PrintTask::Waiting || state == PrintTask::Preparing || full) {
+                break;
+            }
+            first = false;
+        }
+    }
+
+    return nullptr;
+}
+
+QList<PrintTask*> QueueWidget::nextSubmission()
+{
+    qint64 now = mClock.elapsed();
+    qint64 retryIn = -1;
 
-    task->moveToThread(&mThread);
-    connect(task, &PrintTask::finished, this, [this, task]() {
+    // Only the first tasks for each destination may be submitted and only if
+    // nothing else is being submitted to that destination
+    for (auto i = mDestinationQueues.constBegin(); i != mDestinationQueues.constEnd(); ++i) {
+        const QList<PrintTask*> &queue = i.value();
+        PrintTask *first = queue.first();
+        if (first->state() != PrintTask::Ready || mSubmitting.contains(i.key())) {
+            continue;
+        }
+
+        // Gather the prepared tasks that can share a document with it
+        QList<PrintTask*> tasks;
+        tasks.append(first);
+        for (auto j = queue.constBegin() + 1; j != queue.constEnd() && tasks.count() < mBatchSize; ++j) {
+            if ((*j)->state() != PrintTask::Ready || !first->canSubmitWith(*j)) {
+                break;
+            }
+            tasks.append(*j);
+        }
+
+        // Hold a partial batch back until the window closes, as long as more
+        // tasks for the destination are on their way, unless it is urgent or
+        // no more pages can be rendered until it is printed
+        qint64 remaining = mPrepared.value(first) + mBatchWindow - now;
+        bool blocked = first->needsRendering() && mRenderedCount >= RenderAhead;
+        if (tasks.count() < mBatchSize && tasks.count() < queue.count() && remaining > 0 &&
+                first->priority() != PrintTask::Urgent && !blocked) {
+            retryIn = retryIn < 0 ? remaining : qMin(retryIn, remaining);
+            continue;
+        }
+
+        return tasks;
+    }
+
+    // Check again once the earliest window closes
+    if (retryIn >= 0 && !mRetryScheduled) {
+        mRetryScheduled = true;
+        QTimer::singleShot(static_cast<int>(retryIn), this, [this]() {
+            mRetryScheduled = false;
+            dispatch();
+        });
+    }
+
+    return QList<PrintTask*>();
+}
+
+void QueueWidget::prepare(Worker &worker, PrintTask *task)
+{
+    worker.tasks.append(task);
+    worker.stage = QueueMetrics::Prepare;
+    setState(task, PrintTask::Preparing);
+
+    // Share the destination's sink; if it can't be created, the task
+    // reports why when it tries again
+    QSharedPointer<OutputSink> sink = mSinks.value(task->destination());
+    if (!sink) {
+        sink.reset(OutputSink::create(task->destination()));
+        if (sink) {
+            mSinks.insert(task->destination(), sink);
+        }
+    }
+    task->setSink(sink);
+
+    QMetaObject::invokeMethod(worker.context, [this, task]() {
+        qint64 start = QueueMetrics::now();
+        task->prepare();
+        qint64 busyTime = QueueMetrics::now() - start;
+        QMetaObject::invokeMethod(this, [this, task, busyTime]() {
+            onPrepared(task, busyTime);
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+void QueueWidget::render(Worker &worker, PrintTask *task)
+{
+    worker.tasks.append(task);
+    worker.stage = QueueMetrics::Raster;
+    setState(task, PrintTask::Rendering);
+    ++mRenderedCount;
+
+    QMetaObject::invokeMethod(worker.context, [this, task]() {
+        qint64 start = QueueMetrics::now();
+        task->render();
+        qint64 busyTime = QueueMetrics::now() - start;
+        QMetaObject::invokeMethod(this, [this, task, busyTime]() {
+            onRendered(task, busyTime);
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+void QueueWidget::submit(Worker &worker, const QList<PrintTask*> &tasks)
+{
+    worker.tasks = tasks;
+    worker.stage = QueueMetrics::Submit;
+
+    foreach (PrintTask *task, tasks) {
+        mPrepared.remove(task);
+        setState(task, PrintTask::Printing);
+    }
+    mSubmitting.insert(tasks.first()->destination());
+
+    QMetaObject::invokeMethod(worker.context, [this, tasks]() {
+        qint64 start = QueueMetrics::now();
+        PrintTask::submit(tasks);
+        qint64 busyTime = QueueMetrics::now() - start;
+        QMetaObject::invokeMethod(this, [this, tasks, busyTime]() {
+            onSubmitted(tasks, busyTime);
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+void QueueWidget::onPrepared(PrintTask *task, qint64 busyTime)
+{
+    mMetrics.addBusyTime(QueueMetrics::Prepare, busyTime);
+    release(QList<PrintTask*>() << task);
+
+    // The task may have been cancelled while it was being prepared; pages
+    // that are drawn directly are ready as soon as they are laid out
+    if (task->state() == PrintTask::Cancelled) {
+        task->discard();
         delete task;
-        --mQueueLength;
-        updateLabel();
-    });
-    QMetaObject::invokeMethod(task, &PrintTask::print, Qt::QueuedConnection);
+    } else {
+        mPrepared.insert(task, mClock.elapsed());
+        setState(task, task->needsRendering() ? PrintTask::Prepared : PrintTask::Ready);
+    }
+
+    dispatch();
+}
+
+void QueueWidget::onRendered(PrintTask *task, qint64 busyTime)
+{
+    mMetrics.addBusyTime(QueueMetrics::Raster, busyTime);
+    release(QList<PrintTask*>() << task);
+
+    // Only a page that was rendered holds its place until it is printed; if
+    // rendering failed it is drawn when it is printed instead
+    if (task->state() == PrintTask::Cancelled || !task->isRendered()) {
+        --mRenderedCount;
+    }
+
+    // The task may have been cancelled while it was being rendered
+    if (task->state() == PrintTask::Cancelled) {
+        task->discard();
+        delete task;
+    } else {
+        mPrepared.insert(task, mClock.elapsed());
+        setState(task, PrintTask::Ready);
+    }
+
+    dispatch();
+}
+
+void QueueWidget::onSubmitted(const QList<PrintTask*> &tasks, qint64 busyTime)
+{
+    mMetrics.addBusyTime(QueueMetrics::Submit, busyTime);
+
+    // Remove the tasks from the front of the destination's queue
+    foreach (PrintTask *task, tasks) {
+        remove(task);
+    }
+    mSubmitting.remove(tasks.first()->destination());
+
+    release(tasks);
+
+    foreach (PrintTask *task, tasks) {
+        if (task->isRendered()) {
+            --mRenderedCount;
+        }
+        if (task->hasFailed()) {
+            ++mFailedCount;
+        } else {
+            mPagesPrinted += task->pageCount();
+        }
+        foreach (const JobTiming &timing, task->timings()) {
+            mMetrics.record(timing);
+        }
+        delete task;
+    }
+    mQueueLength -= tasks.count();
+
+    // Stop measuring throughput when the queue becomes idle
+    if (!mQueueLength) {
+        mBusyTime += mClock.elapsed() - mBusySince;
+    }
+
+    dispatch();
+}
+
+void QueueWidget::release(const QList<PrintTask*> &tasks)
+{
+    for (auto i = mWorkers.begin(); i != mWorkers.end(); ++i) {
+        if (i->tasks == tasks) {
+            if (i->stage == QueueMetrics::Submit) {
+                i->completed += tasks.count();
+            }
+            i->tasks.clear();
+            break;
+        }
+    }
 }
 
 void QueueWidget::updateLabel()
 {
-    mStatusLabel->setText(
-        mQueueLength ? tr("%1 in queue").arg(mQueueLength) : tr("idle")
-    );
+    int active = 0;
+    QStringList details;
+    for (int i = 0; i < mWorkers.count(); ++i) {
+        const Worker &worker = mWorkers.at(i);
+        QString state = tr("idle");
+        if (!worker.tasks.isEmpty()) {
+            ++active;
+            switch (worker.stage) {
+            case QueueMetrics::Prepare:
+                state = tr("laying out");
+                break;
+            case QueueMetrics::Raster:
+                state = tr("rendering");
+                break;
+            default:
+                state = tr("printing %n sheet(s)", "", worker.tasks.count());
+                break;
+            }
+        }
+        details.append(
+            tr("Worker %1: %2 (%3 done)").arg(i + 1).arg(state).arg(worker.completed)
+        );
+    }
+
+    // Throughput is measured over the time the queue has been busy
+    qint64 busyTime = mBusyTime + (mQueueLength ? mClock.elapsed() - mBusySince : 0);
+    if (busyTime > 0) {
+        details.append(
+            tr("Throughput: %1 pages/min").arg(mPagesPrinted * 60000.0 / busyTime, 0, 'f', 1)
+        );
+    }
+
+    // Show where recent tasks spent their time
+    for (int i = 0; i < QueueMetrics::PhaseCount; ++i) {
+        if (mMetrics.sampleCount(i)) {
+            details.append(
+                tr("%1: p50 %2 ms, p95 %3 ms, p99 %4 ms")
+                    .arg(QueueMetrics::phaseName(i))
+                    .arg(mMetrics.percentile(i, 0.5) / 1000000.0, 0, 'f', 1)
+                    .arg(mMetrics.percentile(i, 0.95) / 1000000.0, 0, 'f', 1)
+                    .arg(mMetrics.percentile(i, 0.99) / 1000000.0, 0, 'f', 1)
+            );
+        }
+    }
+    mMetrics.setQueueLength(mQueueLength);
+
+    // Show how busy each stage is and how many tasks are waiting for it
+    int buffered[QueueMetrics::StageCount] = {};
+    for (int i = 0; i < PrintTask::PriorityCount; ++i) {
+        buffered[QueueMetrics::Prepare] += mWaiting[i].count();
+    }
+    for (auto i = mPrepared.constBegin(); i != mPrepared.constEnd(); ++i) {
+        PrintTask::State state = i.key()->state();
+        if (state == PrintTask::Prepared) {
+            ++buffered[QueueMetrics::Raster];
+        } else if (state == PrintTask::Ready) {
+            ++buffered[QueueMetrics::Submit];
+        }
+    }
+    mMetrics.setActiveTime(busyTime * 1000000);
+    for (int i = 0; i < QueueMetrics::StageCount; ++i) {
+        mMetrics.setBuffered(i, buffered[i]);
+        details.append(
+            tr("Stage %1: %2% busy, %3 waiting")
+                .arg(QueueMetrics::stageName(i))
+                .arg(mMetrics.utilization(i) * 100, 0, 'f', 0)
+                .arg(buffered[i])
+        );
+    }
+
+    // Show how long it took to find the printers, which lookups avoid
+    qint64 refreshTime = PrinterRegistry::instance()->refreshTime();
+    mMetrics.setPrinterRefreshTime(refreshTime);
+    if (refreshTime) {
+        details.append(tr("Printer list: found in %1 ms").arg(refreshTime / 1000000.0, 0, 'f', 1));
+    }
+
+    QString text = tr("idle");
+    if (mQueueLength) {
+        text = tr("%1 in queue (%2/%3 workers active)")
+                .arg(mQueueLength)
+                .arg(active)
+                .arg(mWorkers.count());
+    }
+    if (mMetrics.sampleCount(QueueMetrics::Total)) {
+        text += tr(" - latency p50/p95/p99: %1/%2/%3 ms")
+                .arg(mMetrics.percentile(QueueMetrics::Total, 0.5) / 1000000)
+                .arg(mMetrics.percentile(QueueMetrics::Total, 0.95) / 1000000)
+                .arg(mMetrics.percentile(QueueMetrics::Total, 0.99) / 1000000);
+    }
+    if (mFailedCount) {
+        text += tr(" - %n failed (kept in the spool)", "", mFailedCount);
+    }
+    mStatusLabel->setText(text);
+    mStatusLabel->setToolTip(details.join("\n"));
+
+    // Show how many tasks are in each lane, hiding the empty ones
+    QStringList laneNames = QStringList() << tr("Urgent") << tr("Normal") << tr("Bulk");
+    for (int i = 0; i < PrintTask::PriorityCount; ++i) {
+        int count = mLaneItems[i]->childCount();
+        mLaneItems[i]->setText(0, tr("%1 (%2)").arg(laneNames.at(i)).arg(count));
+        mLaneItems[i]->setHidden(!count);
+    }
 }
 
+void QueueWidget::saveMetrics()
+{
+    if (!mMetrics.save(mMetricsFilename)) {
+        qWarning("unable to write %s", qPrintable(mMetricsFilename));
+    }
+}
+
+void QueueWidget::showJobMenu(const QPoint &pos)
+{
+    QTreeWidgetItem *item = mJobList->itemAt(pos);
+    if (!item || !item->parent()) {
+        return;
+    }
+
+    // Jobs can only be changed until they start printing, and merged jobs
+    // can only be separated until they are laid out
+    qint64 id = item->data(0, Qt::UserRole).toLongLong();
+    PrintTask *task = mTasks.value(id);
+    bool printing = task && task->state() == PrintTask::Printing;
+    bool merged = task && task->requests().count() > 1 && task->state() != PrintTask::Waiting;
+
+    QMenu menu;
+    QAction *moveAction = menu.addAction(tr("Move to Front"));
+    QAction *cancelAction = menu.addAction(tr("Cancel"));
+    moveAction->setEnabled(!printing);
+    cancelAction->setEnabled(!printing && !merged);
+
+    // The job may have finished while the menu was open
+    QAction *action = menu.exec(mJobList->viewport()->mapToGlobal(pos));
+    if (action == moveAction) {
+        moveToFront(id);
+    } else if (action == cancelAction) {
+        cancelTask(id);
+    }
+}
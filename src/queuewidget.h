@@ -25,14 +25,57 @@
 #ifndef QUEUEWIDGET_H
 #define QUEUEWIDGET_H
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QLabel>
-#include <QWidget>
+#include <QList>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
 #include <QThread>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include <QVector>
+#include <QWidget>
 
-class PrintTask;
+#include "outputsink.h"
+#include "printspool.h"
+#include "printtask.h"
+#include "queuemetrics.h"
 
 /**
  * @brief Widget that manages a print queue
+ *
+ * Tasks pass through three stages: they are prepared (laid out), rendered
+ * if their destination prints images, and submitted. A pool of worker
+ * threads works on whichever stage is furthest along, so one task can be
+ * laid out or rendered while another is being printed. A bounded number of
+ * tasks are held between stages, and tasks are submitted to each
+ * destination in the order they were added. Consecutive tasks for the same
+ * destination and orientation are combined into a single document of up to
+ * batchSize() sheets.
+ *
+ * Each task is queued in a priority lane. Urgent tasks are prepared as soon
+ * as a worker is free and are printed as soon as the document being printed
+ * to their destination is finished. Tasks can be cancelled or moved to the
+ * front of the queue until they start printing.
+ *
+ * A task for the same sheet, destination and priority as the last one in
+ * its destination's queue is merged into it unless that one is being laid
+ * out or printed, so that both are laid out once and printed as one set of
+ * copies. Moving either of them moves both, while cancelling one only
+ * takes away its copies.
+ *
+ * If a spool is open, tasks are written to it as they are added and only a
+ * bounded number are prepared ahead of printing, so the depth of the queue
+ * does not determine how much memory is used. Unfinished tasks in the spool
+ * are queued again when it is next opened.
+ *
+ * The time each task spends in each stage is recorded and percentiles are
+ * shown in the widget's tooltip, along with how busy the workers are in
+ * each stage and how many tasks are waiting for it. They can also be written to a file at
+ * regular intervals for monitoring.
  */
 class QueueWidget : public QWidget
 {
@@ -40,19 +83,104 @@ class QueueWidget : public QWidget
 
 public:
 
-    QueueWidget();
+    explicit QueueWidget(int workerCount = QThread::idealThreadCount());
     ~QueueWidget();
 
-    void addTask(PrintTask *task);
+    bool openSpool(const QString &filename, QString *errorString = nullptr);
+
+    qint64 addTask(PrintTask *task, PrintTask::Priority priority = PrintTask::Normal);
+    bool cancelTask(qint64 id);
+    bool moveToFront(qint64 id);
+
+    int queueLength() const;
+    int waitingCount(PrintTask::Priority priority) const;
+    int position(qint64 id) const;
+
+    int batchSize() const;
+    void setBatchSize(int batchSize);
+
+    int batchWindow() const;
+    void setBatchWindow(int batchWindow);
+
+    void setMetricsFile(const QString &filename, int interval);
+
+signals:
+
+    void waitingChanged();
 
 private:
 
+    struct Worker
+    {
+        QThread *thread;
+        QObject *context;
+        QList<PrintTask*> tasks;
+        QueueMetrics::Stage stage;
+        int completed;
+    };
+
+    void enqueue(PrintTask *task, bool front);
+    void updateItem(PrintTask *task);
+    void remove(PrintTask *task);
+    void setState(PrintTask *task, PrintTask::State state);
+
+    void dispatch();
+    PrintTask *takeWaiting();
+    PrintTask *nextRender() const;
+    QList<PrintTask*> nextSubmission();
+    void prepare(Worker &worker, PrintTask *task);
+    void render(Worker &worker, PrintTask *task);
+    void submit(Worker &worker, const QList<PrintTask*> &tasks);
+    void onPrepared(PrintTask *task, qint64 busyTime);
+    void onRendered(PrintTask *task, qint64 busyTime);
+    void onSubmitted(const QList<PrintTask*> &tasks, qint64 busyTime);
+    void release(const QList<PrintTask*> &tasks);
+
     void updateLabel();
+    void saveMetrics();
+    void showJobMenu(const QPoint &pos);
+
+    QVector<Worker> mWorkers;
+    PrintSpool mSpool;
+
+    int mBatchSize;
+    int mBatchWindow;
+
+    // Tasks by ID and those waiting to be prepared in each lane
+    QHash<qint64, PrintTask*> mTasks;
+    QList<PrintTask*> mWaiting[PrintTask::PriorityCount];
+
+    // Tasks for each destination in order of submission, those that have
+    // been laid out (and when they became ready) and the number of rendered
+    // pages, including those being rendered
+    QHash<QString, QList<PrintTask*>> mDestinationQueues;
+    QHash<PrintTask*, qint64> mPrepared;
+    int mRenderedCount;
+    QSet<QString> mSubmitting;
+
+    // Sinks are kept for each destination so that jobs sent to a file are
+    // added to it rather than replacing it
+    QHash<QString, QSharedPointer<OutputSink>> mSinks;
+    bool mRetryScheduled;
+
+    // Throughput while the queue is busy
+    QElapsedTimer mClock;
+    qint64 mBusyTime;
+    qint64 mBusySince;
+    qint64 mPagesPrinted;
+    int mFailedCount;
 
-    QThread mThread;
+    // Latency of recent tasks
+    QueueMetrics mMetrics;
+    QString mMetricsFilename;
+    QTimer mMetricsTimer;
 
     QLabel *mStatusLabel;
+    QTreeWidget *mJobList;
+    QTreeWidgetItem *mLaneItems[PrintTask::PriorityCount];
+    QHash<PrintTask*, QTreeWidgetItem*> mJobItems;
     int mQueueLength;
+    qint64 mLastId;
 };
 
 #endif // QUEUEWIDGET_H
@@ -22,10 +22,17 @@
  * IN THE SOFTWARE.
  */
 
+#include <QCryptographicHash>
+#include <QJsonArray>
+#include <QJsonValue>
 #include <QMarginsF>
 #include <QPen>
 
+#include "barcode.h"
+#include "fitcache.h"
+#include "fitengine.h"
 #include "sheet.h"
+#include "sheetlayout.h"
 
 Sheet::Sheet()
     : orientation(Portrait),
@@ -34,137 +41,341 @@ Sheet::Sheet()
       border(0),
       margin(0),
       copies(1),
+      mRowCount(0),
       mColCount(0)
 {
     font.setBold(true);
     font.setFamily("Calibri");
 }
 
+Sheet Sheet::fromJson(const QJsonObject &object)
+{
+    Sheet sheet;
+
+    sheet.headerText = object.value("header").toString();
+    sheet.footerText = object.value("footer").toString();
+
+    // Accept either a full font description or just a family name
+    QString fontName = object.value("font").toString();
+    if (!fontName.isEmpty() && !sheet.font.fromString(fontName)) {
+        sheet.font.setFamily(fontName);
+    }
+
+    sheet.orientation = object.value("orientation").toString() == "landscape" ?
+                Landscape : Portrait;
+
+    sheet.hSpacing = object.value("hSpacing").toInt(sheet.hSpacing);
+    sheet.vSpacing = object.value("vSpacing").toInt(sheet.vSpacing);
+    sheet.border = object.value("border").toInt(sheet.border);
+    sheet.margin = object.value("margin").toInt(sheet.margin);
+    sheet.copies = object.value("copies").toInt(sheet.copies);
+
+    // Cells are stored as an array of rows, each an array of strings or of
+    // objects with "text" and "type" ("text", "code128" or "qr")
+    QJsonArray rows = object.value("cells").toArray();
+    int cols = 0;
+    foreach (const QJsonValue &row, rows) {
+        cols = qMax(cols, row.toArray().count());
+    }
+    sheet.resize(rows.count(), cols);
+    for (int i = 0; i < rows.count(); ++i) {
+        QJsonArray row = rows.at(i).toArray();
+        for (int j = 0; j < row.count(); ++j) {
+            Cell &cell = sheet.cell(i, j);
+            if (row.at(j).isObject()) {
+                QJsonObject cellObject = row.at(j).toObject();
+                QString type = cellObject.value("type").toString();
+                cell.setText(cellObject.value("text").toString());
+                cell.setType(type == "code128" ? Cell::Code128 :
+                             type == "qr" ? Cell::QrCode : Cell::Text);
+            } else {
+                cell.setText(row.at(j).toString());
+            }
+        }
+    }
+
+    return sheet;
+}
+
+bool Sheet::validate(const QJsonObject &object, QString *errorString)
+{
+    // Reject anything fromJson() would quietly turn into a default
+    if (object.isEmpty()) {
+        *errorString = "expected an object";
+        return false;
+    }
+
+    QJsonValue copies = object.value("copies");
+    if (!copies.isUndefined() && copies.toInt() < 1) {
+        *errorString = "copies must be at least 1";
+        return false;
+    }
+
+    QJsonValue orientation = object.value("orientation");
+    if (!orientation.isUndefined() &&
+            orientation.toString() != "portrait" && orientation.toString() != "landscape") {
+        *errorString = "orientation must be \"portrait\" or \"landscape\"";
+        return false;
+    }
+
+    return true;
+}
+
+SheetSnapshot Sheet::snapshot() const
+{
+    return SheetSnapshot(new Sheet(*this));
+}
+
+QByteArray Sheet::fingerprint() const
+{
+    // Copies are left out so that sheets which only differ in how many
+    // times they are printed have the same fingerprint
+    Sheet sheet(*this);
+    sheet.copies = 0;
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << sheet;
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+}
+
+int Sheet::rows() const
+{
+    return mRowCount;
+}
+
+int Sheet::cols() const
+{
+    return mColCount;
+}
+
 Cell &Sheet::cell(int row, int col)
 {
-    Q_ASSERT(row < mCells.count());
-    auto &cellRow = mCells[row];
-    if (cellRow.count() != mColCount) {
-        cellRow.resize(mColCount);
+    Q_ASSERT(row < mRowCount && col < mColCount);
+    return mCells[row * mColCount + col];
+}
+
+const Cell &Sheet::cell(int row, int col) const
+{
+    Q_ASSERT(row < mRowCount && col < mColCount);
+    return mCells.at(row * mColCount + col);
+}
+
+const QVector<Cell> &Sheet::cells() const
+{
+    return mCells;
+}
+
+void Sheet::resize(int rows, int cols)
+{
+    if (cols == mColCount) {
+        // Rows are contiguous, so they can be added or removed at the end
+        mCells.resize(rows * cols);
+    } else {
+        // Copy the cells that remain into their new positions
+        QVector<Cell> cells(rows * cols);
+        int copyRows = qMin(rows, mRowCount);
+        int copyCols = qMin(cols, mColCount);
+        for (int i = 0; i < copyRows; ++i) {
+            for (int j = 0; j < copyCols; ++j) {
+                cells[i * cols + j] = mCells.at(i * mColCount + j);
+            }
+        }
+        mCells = cells;
     }
-    return cellRow[col];
+
+    mRowCount = rows;
+    mColCount = cols;
 }
 
 void Sheet::setRows(int rows)
 {
-    mCells.resize(rows);
+    resize(rows, mColCount);
 }
 
 void Sheet::setCols(int cols)
 {
-    mColCount = cols;
+    resize(mRowCount, cols);
 }
 
-void Sheet::draw(QPaintDevice *device, const QSize &size)
+QRectF Sheet::headerRect(const QSize &size) const
 {
-    bool hasHeader = !headerText.isEmpty();
-    bool hasFooter = !footerText.isEmpty();
+    return SheetLayout::get(*this, size)->headerRect();
+}
 
+QRectF Sheet::footerRect(const QSize &size) const
+{
+    return SheetLayout::get(*this, size)->footerRect();
+}
+
+QRectF Sheet::cellRect(const QSize &size, int row, int col) const
+{
+    return SheetLayout::get(*this, size)->cellRect(row, col);
+}
+
+void Sheet::draw(QPaintDevice *device, const QSize &size, const QRectF &dirtyRect) const
+{
     // Ensure non-zero rows and columns
-    if (!mCells.count() || !mColCount) {
+    if (!mRowCount || !mColCount) {
         return;
     }
 
     // Begin painting
     QPainter painter;
     painter.begin(device);
+    draw(painter, size, dirtyRect);
+
+    // Finish painting
+    painter.end();
+}
+
+void Sheet::draw(QPainter &painter, const QSize &size, const QRectF &dirtyRect) const
+{
+    // Ensure non-zero rows and columns
+    if (!mRowCount || !mColCount) {
+        return;
+    }
+
+    // Map the logical size onto the whole device
+    QPaintDevice *device = painter.device();
+    painter.save();
     painter.setRenderHint(QPainter::Antialiasing);
     painter.setWindow(0, 0, size.width(), size.height());
     painter.setViewport(0, 0, device->width(), device->height());
 
-    // Draw the border
-    if (border) {
-        auto halfBorder = border / 2;
-        painter.setPen(QPen(Qt::black, border, Qt::SolidLine, Qt::SquareCap, Qt::MiterJoin));
-        painter.drawRect(halfBorder, halfBorder, size.width() - border, size.height() - border);
+    // Limit painting to the dirty rect (if any), erasing what was there
+    bool partial = !dirtyRect.isNull();
+    if (partial) {
+        painter.setClipRect(dirtyRect);
+        painter.fillRect(dirtyRect, Qt::white);
     }
 
-    // Create a rect for the client area
-    QRectF clientRect(margin, margin, size.width() - margin * 2, size.height() - margin * 2);
+    // Create the engine used for fitting text, sharing previous results
+    FitEngine engine(painter, FitCache::instance());
 
-    // Calculate the number of rows being drawn
-    int rowCount = mCells.count() + (hasHeader ? 1 : 0) + (hasFooter ? 1 : 0);
+    // Use the geometry shared by sheets laid out the same way
+    QSharedPointer<const SheetLayout> layout = SheetLayout::get(*this, size);
 
-    // Calculate the cell width and height, taking spacing into account
-    qreal vOffset = 0;
-    qreal cellWidth = (clientRect.width() - hSpacing * (mColCount - 1)) / mColCount;
-    qreal cellHeight = (clientRect.height() - vSpacing * (rowCount - 1)) / rowCount;
+    // Draw the border
+    if (border) {
+        painter.setPen(QPen(Qt::black, border, Qt::SolidLine, Qt::SquareCap, Qt::MiterJoin));
+        painter.drawRect(layout->borderRect());
+    }
 
     // Draw the header if applicable
-    if (hasHeader) {
-        fitText(
-            painter,
-            QRectF(
-                clientRect.left(),
-                clientRect.top(),
-                clientRect.width(),
-                cellHeight
-            ),
-            headerText
-        );
-        vOffset = cellHeight + vSpacing;
+    if (!headerText.isEmpty()) {
+        QRectF rect = layout->headerRect();
+        if (!partial || rect.intersects(dirtyRect)) {
+            fitText(painter, engine, rect, headerText);
+        }
     }
 
     // Draw each cell
+    const QVector<QRectF> &rects = layout->cellRects();
     for (auto i = 0; i < mCells.count(); ++i) {
-        for (auto j = 0; j < mColCount; ++j) {
-            auto &c = cell(i, j);
-            fitText(
-                painter,
-                QRectF(
-                    clientRect.left() + j * (cellWidth + hSpacing),
-                    clientRect.top() + i * (cellHeight + vSpacing) + vOffset,
-                    cellWidth,
-                    cellHeight
-                ),
-                c.text()
-            );
+        const QRectF &rect = rects.at(i);
+        if (!partial || rect.intersects(dirtyRect)) {
+            drawCell(painter, engine, rect, mCells.at(i));
         }
     }
 
     // Draw the footer (if applicable)
-    if (hasFooter) {
-        fitText(
-            painter,
-            QRectF(
-                clientRect.left(),
-                clientRect.bottom() - cellHeight,
-                clientRect.width(),
-                cellHeight
-            ),
-            footerText
-        );
+    if (!footerText.isEmpty()) {
+        QRectF rect = layout->footerRect();
+        if (!partial || rect.intersects(dirtyRect)) {
+            fitText(painter, engine, rect, footerText);
+        }
     }
 
-    // Finish painting
-    painter.end();
+    painter.restore();
+}
+
+void Sheet::drawCell(QPainter &painter,
+                     FitEngine &engine,
+                     const QRectF &rect,
+                     const Cell &cell) const
+{
+    // Payloads that can't be encoded are drawn as text instead
+    QSharedPointer<const Barcode> barcode = Barcode::get(cell);
+    if (barcode) {
+        barcode->draw(painter, rect);
+    } else {
+        fitText(painter, engine, rect, cell.text());
+    }
 }
 
 void Sheet::fitText(QPainter &painter,
+                    FitEngine &engine,
                     const QRectF &rect,
                     const QString &text) const
 {
-    QFont trialFont = font;
+    // Find the largest size at which the text fits in the rect
+    int fontSize = engine.fit(font, rect, text);
+    if (!fontSize) {
+        return;
+    }
+
+    // Draw the text at that size
+    QFont fitFont = font;
+    fitFont.setPointSize(fontSize);
+    painter.setFont(fitFont);
+    painter.drawText(rect, Qt::AlignVCenter, text);
+}
+
+QDataStream &operator<<(QDataStream &stream, const Sheet &sheet)
+{
+    stream << sheet.headerText << sheet.footerText << sheet.font
+           << static_cast<qint32>(sheet.orientation)
+           << static_cast<qint32>(sheet.hSpacing) << static_cast<qint32>(sheet.vSpacing)
+           << static_cast<qint32>(sheet.border) << static_cast<qint32>(sheet.margin)
+           << static_cast<qint32>(sheet.copies)
+           << static_cast<qint32>(sheet.rows()) << static_cast<qint32>(sheet.cols());
+    foreach (const Cell &cell, sheet.cells()) {
+        stream << cell.text() << static_cast<qint32>(cell.type());
+    }
+    return stream;
+}
 
-    // Beginning with a size identical to the height of the bounding rect,
-    // slowly reduce the text size until it fits in the rect
-    for (int fontSize = static_cast<int>(rect.height()); fontSize > 0; fontSize -= 2) {
+QDataStream &readSheet(QDataStream &stream, Sheet &sheet, bool typed)
+{
+    qint32 orientation, hSpacing, vSpacing, border, margin, copies, rows, cols;
+    stream >> sheet.headerText >> sheet.footerText >> sheet.font
+           >> orientation >> hSpacing >> vSpacing >> border >> margin >> copies
+           >> rows >> cols;
+    if (stream.status() != QDataStream::Ok || rows < 0 || cols < 0) {
+        stream.setStatus(QDataStream::ReadCorruptData);
+        return stream;
+    }
 
-        // Calculate the size of the rect at this font size
-        trialFont.setPointSize(fontSize);
-        painter.setFont(trialFont);
-        QRectF requiredRect = painter.boundingRect(rect, 0, text);
+    sheet.orientation = orientation;
+    sheet.hSpacing = hSpacing;
+    sheet.vSpacing = vSpacing;
+    sheet.border = border;
+    sheet.margin = margin;
+    sheet.copies = copies;
 
-        // If the text fits, draw it
-        if (requiredRect.width() <= rect.width() &&
-                requiredRect.height() <= rect.height()) {
-            painter.drawText(rect, Qt::AlignVCenter, text);
-            return;
+    sheet.resize(rows, cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            QString text;
+            qint32 type = Cell::Text;
+            stream >> text;
+            if (typed) {
+                stream >> type;
+            }
+            sheet.cell(i, j).setText(text);
+            sheet.cell(i, j).setType(static_cast<Cell::Type>(type));
         }
     }
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, Sheet &sheet)
+{
+    return readSheet(stream, sheet, true);
+}
+
+QDataStream &readUntypedSheet(QDataStream &stream, Sheet &sheet)
+{
+    return readSheet(stream, sheet, false);
 }
@@ -25,18 +25,28 @@
 #ifndef SHEET_H
 #define SHEET_H
 
+#include <QByteArray>
+#include <QDataStream>
 #include <QFont>
+#include <QJsonObject>
 #include <QPaintDevice>
 #include <QPainter>
 #include <QRectF>
+#include <QSharedPointer>
 #include <QSize>
 #include <QString>
 #include <QVector>
 
 #include "cell.h"
 
+class FitEngine;
+
 /**
  * @brief Sheet containing cells
+ *
+ * Sheets are values whose members are implicitly shared, so copying one is
+ * cheap and a copy only detaches the members that are changed afterwards.
+ * Use snapshot() to hand an immutable copy to other threads.
  */
 class Sheet
 {
@@ -49,6 +59,12 @@ public:
 
     Sheet();
 
+    static Sheet fromJson(const QJsonObject &object);
+    static bool validate(const QJsonObject &object, QString *errorString);
+
+    QSharedPointer<const Sheet> snapshot() const;
+    QByteArray fingerprint() const;
+
     QString headerText;
     QString footerText;
 
@@ -64,20 +80,48 @@ public:
 
     int copies;
 
+    int rows() const;
+    int cols() const;
+
     Cell &cell(int row, int col);
+    const Cell &cell(int row, int col) const;
+    const QVector<Cell> &cells() const;
+
+    void resize(int rows, int cols);
     void setRows(int rows);
     void setCols(int cols);
 
-    void draw(QPaintDevice *device, const QSize &size);
+    QRectF headerRect(const QSize &size) const;
+    QRectF footerRect(const QSize &size) const;
+    QRectF cellRect(const QSize &size, int row, int col) const;
+
+    void draw(QPaintDevice *device, const QSize &size, const QRectF &dirtyRect = QRectF()) const;
+    void draw(QPainter &painter, const QSize &size, const QRectF &dirtyRect = QRectF()) const;
 
 private:
 
+    void drawCell(QPainter &painter,
+                  FitEngine &engine,
+                  const QRectF &rect,
+                  const Cell &cell) const;
     void fitText(QPainter &painter,
+                 FitEngine &engine,
                  const QRectF &rect,
                  const QString &text) const;
 
+    int mRowCount;
     int mColCount;
-    QVector<QVector<Cell>> mCells;
+
+    // Cells are stored contiguously in row-major order
+    QVector<Cell> mCells;
 };
 
+typedef QSharedPointer<const Sheet> SheetSnapshot;
+
+QDataStream &operator<<(QDataStream &stream, const Sheet &sheet);
+QDataStream &operator>>(QDataStream &stream, Sheet &sheet);
+
+// Read a sheet written before cells had types, which are all text
+QDataStream &readUntypedSheet(QDataStream &stream, Sheet &sheet);
+
 #endif // SHEET_H
@@ -0,0 +1,153 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSizeF>
+
+#include "sheet.h"
+#include "sheetlayout.h"
+
+// Largest total number of cells in cached layouts
+const int MaxCachedCells = 1000000;
+
+QSharedPointer<const SheetLayout> SheetLayout::get(const Sheet &sheet, const QSize &size)
+{
+    Key key;
+    key.width = size.width();
+    key.height = size.height();
+    key.rows = sheet.rows();
+    key.cols = sheet.cols();
+    key.hSpacing = sheet.hSpacing;
+    key.vSpacing = sheet.vSpacing;
+    key.border = sheet.border;
+    key.margin = sheet.margin;
+    key.header = !sheet.headerText.isEmpty();
+    key.footer = !sheet.footerText.isEmpty();
+
+    static QMutex mutex;
+    static QCache<Key, QSharedPointer<const SheetLayout>> cache(MaxCachedCells);
+
+    QMutexLocker locker(&mutex);
+    QSharedPointer<const SheetLayout> *cached = cache.object(key);
+    if (cached) {
+        return *cached;
+    }
+
+    // Cells count towards the size of the cache
+    QSharedPointer<const SheetLayout> layout(new SheetLayout(key));
+    cache.insert(
+        key,
+        new QSharedPointer<const SheetLayout>(layout),
+        qMax(key.rows * key.cols, 1)
+    );
+    return layout;
+}
+
+QSize SheetLayout::size() const
+{
+    return mSize;
+}
+
+int SheetLayout::rows() const
+{
+    return mRows;
+}
+
+int SheetLayout::cols() const
+{
+    return mCols;
+}
+
+QRectF SheetLayout::borderRect() const
+{
+    return mBorderRect;
+}
+
+QRectF SheetLayout::headerRect() const
+{
+    return mHeaderRect;
+}
+
+QRectF SheetLayout::footerRect() const
+{
+    return mFooterRect;
+}
+
+QRectF SheetLayout::cellRect(int row, int col) const
+{
+    Q_ASSERT(row < mRows && col < mCols);
+    return mCellRects.at(row * mCols + col);
+}
+
+const QVector<QRectF> &SheetLayout::cellRects() const
+{
+    return mCellRects;
+}
+
+SheetLayout::SheetLayout(const Key &key)
+    : mSize(key.width, key.height),
+      mRows(key.rows),
+      mCols(key.cols)
+{
+    // The border is centered on the edge of the page
+    int halfBorder = key.border / 2;
+    mBorderRect = QRectF(halfBorder, halfBorder, key.width - key.border, key.height - key.border);
+
+    if (!mRows || !mCols) {
+        return;
+    }
+
+    QRectF clientRect(key.margin, key.margin, key.width - key.margin * 2, key.height - key.margin * 2);
+
+    // Calculate the number of rows being drawn
+    int rowCount = mRows + (key.header ? 1 : 0) + (key.footer ? 1 : 0);
+
+    // Calculate the cell width and height, taking spacing into account
+    QSizeF cellSize(
+        (clientRect.width() - key.hSpacing * (mCols - 1)) / mCols,
+        (clientRect.height() - key.vSpacing * (rowCount - 1)) / rowCount
+    );
+
+    mHeaderRect = clientRect;
+    mHeaderRect.setHeight(cellSize.height());
+    mFooterRect = clientRect;
+    mFooterRect.setTop(clientRect.bottom() - cellSize.height());
+
+    // Skip over the header if one is being drawn
+    qreal vOffset = key.header ? cellSize.height() + key.vSpacing : 0;
+
+    mCellRects.reserve(mRows * mCols);
+    for (int i = 0; i < mRows; ++i) {
+        for (int j = 0; j < mCols; ++j) {
+            mCellRects.append(QRectF(
+                clientRect.left() + j * (cellSize.width() + key.hSpacing),
+                clientRect.top() + i * (cellSize.height() + key.vSpacing) + vOffset,
+                cellSize.width(),
+                cellSize.height()
+            ));
+        }
+    }
+}
@@ -0,0 +1,110 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef SHEETLAYOUT_H
+#define SHEETLAYOUT_H
+
+#include <QHash>
+#include <QRectF>
+#include <QSharedPointer>
+#include <QSize>
+#include <QVector>
+
+class Sheet;
+
+/**
+ * @brief Geometry of a sheet laid out on a page
+ *
+ * A layout depends only on the page size, the grid, the spacing, the margin,
+ * the border and whether there is a header and footer - not on any text - so
+ * layouts are cached and shared by every sheet with the same geometry. All
+ * rects are in the page's logical coordinates; mapping them to a device is
+ * left to the painter's transform.
+ */
+class SheetLayout
+{
+public:
+
+    static QSharedPointer<const SheetLayout> get(const Sheet &sheet, const QSize &size);
+
+    QSize size() const;
+    int rows() const;
+    int cols() const;
+
+    QRectF borderRect() const;
+    QRectF headerRect() const;
+    QRectF footerRect() const;
+    QRectF cellRect(int row, int col) const;
+
+    const QVector<QRectF> &cellRects() const;
+
+private:
+
+    struct Key
+    {
+        int width;
+        int height;
+        int rows;
+        int cols;
+        int hSpacing;
+        int vSpacing;
+        int border;
+        int margin;
+        bool header;
+        bool footer;
+
+        bool operator==(const Key &other) const
+        {
+            return width == other.width && height == other.height &&
+                    rows == other.rows && cols == other.cols &&
+                    hSpacing == other.hSpacing && vSpacing == other.vSpacing &&
+                    border == other.border && margin == other.margin &&
+                    header == other.header && footer == other.footer;
+        }
+
+        friend uint qHash(const Key &key, uint seed = 0)
+        {
+            return qHash(key.width ^ (key.height << 16), seed) ^
+                    qHash(key.rows ^ (key.cols << 16), seed) ^
+                    qHash(key.hSpacing ^ (key.vSpacing << 16), seed) ^
+                    qHash(key.border ^ (key.margin << 16), seed) ^
+                    qHash(key.header | (key.footer << 1), seed);
+        }
+    };
+
+    explicit SheetLayout(const Key &key);
+
+    QSize mSize;
+    int mRows;
+    int mCols;
+
+    QRectF mBorderRect;
+    QRectF mHeaderRect;
+    QRectF mFooterRect;
+
+    // Cell rects in row-major order
+    QVector<QRectF> mCellRects;
+};
+
+#endif // SHEETLAYOUT_H
@@ -24,7 +24,11 @@
 
 #include <QGridLayout>
 #include <QHeaderView>
+#include <QAction>
 #include <QLabel>
+#include <QMenu>
+#include <QModelIndex>
+#include <QPair>
 #include <QTableWidget>
 #include <QTableWidgetItem>
 
@@ -52,13 +56,24 @@ SheetWidget::SheetWidget()
       mMarginSpinBox(new QSpinBox),
       mCopiesSpinBox(new QSpinBox)
 {
+    // Adding or removing the header / footer changes the number of rows
     connect(mHeaderEdit, &QLineEdit::textChanged, [this](const QString &text) {
+        bool rowsChanged = mSheet.headerText.isEmpty() != text.isEmpty();
         mSheet.headerText = text;
-        emit changed();
+        if (rowsChanged) {
+            emit layoutChanged();
+        } else {
+            emit headerChanged();
+        }
     });
     connect(mFooterEdit, &QLineEdit::textChanged, [this](const QString &text) {
+        bool rowsChanged = mSheet.footerText.isEmpty() != text.isEmpty();
         mSheet.footerText = text;
-        emit changed();
+        if (rowsChanged) {
+            emit layoutChanged();
+        } else {
+            emit footerChanged();
+        }
     });
 
     // Create the table
@@ -69,29 +84,57 @@ SheetWidget::SheetWidget()
     connect(tableWidget, &QTableWidget::cellChanged, [this, tableWidget](int row, int col) {
         mSheet.cell(row, col).setText(tableWidget->item(row, col)->text());
         tableWidget->resizeRowToContents(row);
-        emit changed();
+        emit cellChanged(row, col);
+    });
+
+    // Allow cells to be drawn as barcodes instead of text
+    tableWidget->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(tableWidget, &QTableWidget::customContextMenuRequested, [this, tableWidget](const QPoint &pos) {
+        QModelIndex index = tableWidget->indexAt(pos);
+        if (!index.isValid()) {
+            return;
+        }
+        Cell::Type current = mSheet.cell(index.row(), index.column()).type();
+        QMenu menu;
+        QList<QPair<Cell::Type, QString>> types;
+        types << qMakePair(Cell::Text, tr("Text"))
+              << qMakePair(Cell::Code128, tr("Code 128 Barcode"))
+              << qMakePair(Cell::QrCode, tr("QR Code"));
+        foreach (const auto &type, types) {
+            QAction *action = menu.addAction(type.second);
+            action->setCheckable(true);
+            action->setChecked(current == type.first);
+            action->setData(type.first);
+        }
+        QAction *action = menu.exec(tableWidget->viewport()->mapToGlobal(pos));
+        if (action) {
+            mSheet.cell(index.row(), index.column()).setType(
+                static_cast<Cell::Type>(action->data().toInt())
+            );
+            emit cellChanged(index.row(), index.column());
+        }
     });
 
     // Create the spinners for the table dimensions
     connect(mRowSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this, tableWidget](int val) {
         mSheet.setRows(val);
         tableWidget->setRowCount(val);
-        emit changed();
+        emit layoutChanged();
     });
     connect(mColSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this, tableWidget](int val) {
         mSheet.setCols(val);
         tableWidget->setColumnCount(val);
-        emit changed();
+        emit layoutChanged();
     });
 
     // Create the spinners for spacing
     connect(mHSpacingSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int val) {
         mSheet.hSpacing = val;
-        emit changed();
+        emit layoutChanged();
     });
     connect(mVSpacingSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int val) {
         mSheet.vSpacing = val;
-        emit changed();
+        emit layoutChanged();
     });
 
     // Create the combo box for page orientation
@@ -99,17 +142,17 @@ SheetWidget::SheetWidget()
     mComboBox->addItem(tr("Landscape"), Sheet::Landscape);
     connect(mComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), [this]() {
         mSheet.orientation = mComboBox->currentData().toInt();
-        emit changed();
+        emit layoutChanged();
     });
 
     // Create the combo box for border and margin
     connect(mBorderSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int val) {
         mSheet.border = val;
-        emit changed();
+        emit layoutChanged();
     });
     connect(mMarginSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int val) {
         mSheet.margin = val;
-        emit changed();
+        emit layoutChanged();
     });
 
     // Same for copies
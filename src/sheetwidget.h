@@ -47,7 +47,10 @@ public:
 
 signals:
 
-    void changed();
+    void cellChanged(int row, int col);
+    void headerChanged();
+    void footerChanged();
+    void layoutChanged();
 
 public slots:
 
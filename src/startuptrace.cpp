@@ -0,0 +1,95 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QMutexLocker>
+
+#include "startuptrace.h"
+
+StartupTrace::StartupTrace()
+    : mEnabled(false)
+{
+    mClock.start();
+}
+
+StartupTrace *StartupTrace::instance()
+{
+    static StartupTrace trace;
+    return &trace;
+}
+
+void StartupTrace::setEnabled(bool enabled)
+{
+    QMutexLocker locker(&mMutex);
+    if (enabled && !mEnabled) {
+        for (int i = 0; i < mMarks.count(); ++i) {
+            write(i);
+        }
+    }
+    mEnabled = enabled;
+}
+
+void StartupTrace::mark(const QString &phase)
+{
+    qint64 time = mClock.nsecsElapsed();
+
+    QMutexLocker locker(&mMutex);
+    foreach (const auto &mark, mMarks) {
+        if (mark.first == phase) {
+            return;
+        }
+    }
+    mMarks.append(qMakePair(phase, time));
+    if (mEnabled) {
+        write(mMarks.count() - 1);
+    }
+}
+
+void StartupTrace::watch(QWidget *window)
+{
+    window->installEventFilter(this);
+}
+
+bool StartupTrace::eventFilter(QObject *watched, QEvent *event)
+{
+    // Signal once the window has finished painting for the first time
+    if (event->type() == QEvent::Paint) {
+        watched->removeEventFilter(this);
+        mark("first paint");
+        QMetaObject::invokeMethod(this, [this]() {
+            emit firstPaint();
+        }, Qt::QueuedConnection);
+    }
+    return false;
+}
+
+void StartupTrace::write(int index)
+{
+    // Show the time since the previous phase as well
+    const QPair<QString, qint64> &mark = mMarks.at(index);
+    qint64 previous = index > 0 ? mMarks.at(index - 1).second : 0;
+    qInfo("startup: %8.1f ms (+%7.1f ms) %s",
+          mark.second / 1000000.0,
+          (mark.second - previous) / 1000000.0,
+          qPrintable(mark.first));
+}
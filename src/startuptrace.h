@@ -0,0 +1,81 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QWidget>
+
+/**
+ * @brief Timestamps for each phase of starting the application
+ *
+ * Times are measured from the first use of the trace, which should be at
+ * the top of main(). Each phase is only recorded the first time it is
+ * reached, so phases can be marked from code that runs repeatedly. When
+ * the trace is enabled, phases are written to the log as they are reached
+ * (including those reached before it was enabled). Phases can be marked
+ * from any thread.
+ */
+class StartupTrace : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    static StartupTrace *instance();
+
+    void setEnabled(bool enabled);
+    void mark(const QString &phase);
+
+    void watch(QWidget *window);
+
+signals:
+
+    void firstPaint();
+
+protected:
+
+    virtual bool eventFilter(QObject *watched, QEvent *event);
+
+private:
+
+    StartupTrace();
+
+    void write(int index);
+
+    QElapsedTimer mClock;
+
+    QMutex mMutex;
+    bool mEnabled;
+    QList<QPair<QString, qint64>> mMarks;
+};
+
+#endif // STARTUPTRACE_H
@@ -0,0 +1,238 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QJsonValue>
+#include <QList>
+#include <QMutexLocker>
+#include <QPointer>
+
+#include "outputsink.h"
+#include "printtask.h"
+#include "queuewidget.h"
+#include "sheet.h"
+#include "submissionserver.h"
+
+// Largest request accepted, to protect against clients that never send a
+// newline
+const qint64 MaxRequestSize = 64 * 1024 * 1024;
+
+// Values of "priority" for each lane, in the order of PrintTask::Priority
+const char *const PriorityNames[] = {"urgent", "normal", "bulk"};
+
+/**
+ * @brief Sheet from a request that is ready to be queued
+ */
+struct Job
+{
+    QString destination;
+    SheetSnapshot sheet;
+    PrintTask::Priority priority;
+};
+
+static PrintTask::Priority priorityFor(const QJsonValue &value)
+{
+    for (int i = 0; i < PrintTask::PriorityCount; ++i) {
+        if (value.toString() == PriorityNames[i]) {
+            return static_cast<PrintTask::Priority>(i);
+        }
+    }
+    return PrintTask::Normal;
+}
+
+SubmissionServer::SubmissionServer(QueueWidget *queueWidget, QObject *parent)
+    : QObject(parent),
+      mQueueWidget(queueWidget),
+      mServer(new QLocalServer)
+{
+    // Only allow the current user to submit jobs
+    mServer->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(mServer, &QLocalServer::newConnection, mServer, [this]() {
+        onNewConnection();
+    });
+
+    // Start the thread
+    mServer->moveToThread(&mThread);
+    mThread.start();
+}
+
+SubmissionServer::~SubmissionServer()
+{
+    mThread.quit();
+    mThread.wait();
+    delete mServer;
+}
+
+void SubmissionServer::setDestination(const QString &destination)
+{
+    QMutexLocker locker(&mMutex);
+    mDestination = destination;
+}
+
+bool SubmissionServer::listen(const QString &name, QString *errorString)
+{
+    // The server must start listening on its own thread
+    bool listening = false;
+    QMetaObject::invokeMethod(mServer, [this, name, errorString, &listening]() {
+        QLocalServer::removeServer(name);
+        listening = mServer->listen(name);
+        if (!listening && errorString) {
+            *errorString = mServer->errorString();
+        }
+    }, Qt::BlockingQueuedConnection);
+    return listening;
+}
+
+QString SubmissionServer::serverName() const
+{
+    return mServer->fullServerName();
+}
+
+void SubmissionServer::onNewConnection()
+{
+    while (QLocalSocket *socket = mServer->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::readyRead, mServer, [this, socket]() {
+            onReadyRead(socket);
+        });
+        connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+    }
+}
+
+void SubmissionServer::onReadyRead(QLocalSocket *socket)
+{
+    while (socket->canReadLine()) {
+        QByteArray line = socket->readLine().trimmed();
+        if (!line.isEmpty()) {
+            handleRequest(socket, line);
+        }
+    }
+
+    if (socket->bytesAvailable() > MaxRequestSize) {
+        socket->write(errorReply("request too large"));
+        socket->disconnectFromServer();
+    }
+}
+
+void SubmissionServer::handleRequest(QLocalSocket *socket, const QByteArray &line)
+{
+    QString destination;
+    {
+        QMutexLocker locker(&mMutex);
+        destination = mDestination;
+    }
+
+    // Parse and check every sheet before any of them are queued
+    QList<Job> jobs;
+    QByteArray reply;
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(line, &error);
+    if (error.error != QJsonParseError::NoError) {
+        reply = errorReply(error.errorString());
+    } else {
+        QJsonArray values = document.isArray() ?
+                    document.array() : QJsonArray() << document.object();
+        for (int i = 0; i < values.count(); ++i) {
+            QJsonObject object = values.at(i).toObject();
+            QString errorString;
+            if (!validate(object, destination, &errorString)) {
+                reply = errorReply(QString("sheet %1: %2").arg(i).arg(errorString));
+                break;
+            }
+            Job job;
+            job.destination = object.value("destination").toString(destination);
+            job.sheet = Sheet::fromJson(object).snapshot();
+            job.priority = priorityFor(object.value("priority"));
+            jobs.append(job);
+        }
+    }
+
+    // Queue the jobs on the GUI thread; errors take the same route so that
+    // replies are sent in the order the requests arrived
+    QPointer<QLocalSocket> pointer(socket);
+    QLocalServer *server = mServer;
+    QueueWidget *queueWidget = mQueueWidget;
+    QMetaObject::invokeMethod(queueWidget, [queueWidget, server, pointer, jobs, reply]() {
+        QByteArray data = reply;
+        if (data.isEmpty()) {
+            QJsonArray results;
+            for (auto i = jobs.constBegin(); i != jobs.constEnd(); ++i) {
+                qint64 id = queueWidget->addTask(new PrintTask(i->destination, i->sheet), i->priority);
+                QJsonObject result;
+                result.insert("id", static_cast<double>(id));
+                result.insert("position", queueWidget->position(id));
+                results.append(result);
+            }
+            QJsonObject object;
+            object.insert("jobs", results);
+            data = QJsonDocument(object).toJson(QJsonDocument::Compact) + "\n";
+        }
+        QMetaObject::invokeMethod(server, [pointer, data]() {
+            if (pointer) {
+                pointer->write(data);
+            }
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+QByteArray SubmissionServer::errorReply(const QString &errorString) const
+{
+    QJsonObject object;
+    object.insert("error", errorString);
+    return QJsonDocument(object).toJson(QJsonDocument::Compact) + "\n";
+}
+
+bool SubmissionServer::validate(const QJsonObject &object, const QString &destination,
+                                QString *errorString) const
+{
+    if (!Sheet::validate(object, errorString)) {
+        return false;
+    }
+
+    // There must be something to print
+    QJsonArray rows = object.value("cells").toArray();
+    if (rows.isEmpty() || rows.first().toArray().isEmpty()) {
+        *errorString = "no cells";
+        return false;
+    }
+
+    QJsonValue priority = object.value("priority");
+    if (!priority.isUndefined() && priority.toString() != PriorityNames[PrintTask::Urgent] &&
+            priority.toString() != PriorityNames[PrintTask::Normal] &&
+            priority.toString() != PriorityNames[PrintTask::Bulk]) {
+        *errorString = "priority must be \"urgent\", \"normal\" or \"bulk\"";
+        return false;
+    }
+
+    QString jobDestination = object.value("destination").toString(destination);
+    if (!OutputSink::isValidDestination(jobDestination)) {
+        *errorString = jobDestination.isEmpty() ?
+                    QString("no destination") :
+                    QString("invalid destination: %1").arg(jobDestination);
+        return false;
+    }
+
+    return true;
+}
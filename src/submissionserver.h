@@ -0,0 +1,84 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Nathan Osman
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef SUBMISSIONSERVER_H
+#define SUBMISSIONSERVER_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QThread>
+
+class QueueWidget;
+
+/**
+ * @brief Accept print jobs from other programs over a local socket
+ *
+ * Clients send one request per line: either a sheet in the same JSON format
+ * used by batch mode or an array of them. A sheet may name its own
+ * "destination"; otherwise the server's default is used. Each request is
+ * answered with a line containing the ID and queue position of every job
+ * it added, or an error if any of its sheets was invalid (in which case
+ * none of them are queued).
+ *
+ * Connections are serviced and requests parsed on a separate thread so
+ * that busy clients do not hold up the user interface.
+ */
+class SubmissionServer : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit SubmissionServer(QueueWidget *queueWidget, QObject *parent = nullptr);
+    ~SubmissionServer();
+
+    void setDestination(const QString &destination);
+
+    bool listen(const QString &name, QString *errorString = nullptr);
+    QString serverName() const;
+
+private:
+
+    void onNewConnection();
+    void onReadyRead(QLocalSocket *socket);
+    void handleRequest(QLocalSocket *socket, const QByteArray &line);
+
+    QByteArray errorReply(const QString &errorString) const;
+    bool validate(const QJsonObject &object, const QString &destination, QString *errorString) const;
+
+    QueueWidget *mQueueWidget;
+
+    QMutex mMutex;
+    QString mDestination;
+
+    QThread mThread;
+    QLocalServer *mServer;
+};
+
+#endif // SUBMISSIONSERVER_H